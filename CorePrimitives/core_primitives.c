@@ -21,8 +21,8 @@ const char* PrimitiveTypeNames[] = {
 /* Constructor for int_Object */
 int_Object* new_int(VM* vm, int64_t value) {
     // perform check in constant table
-    if (value >= -510 && value <= 510) {
-        PrimitiveObject *cached = vm->constants[3 + value + 510];
+    if (value >= -SMALL_INT_MAX && value <= SMALL_INT_MAX) {
+        PrimitiveObject *cached = vm->constants[3 + value + SMALL_INT_MAX];
         if (cached) {
             // printf("using cached value\n");
             // printf("value: %ld\n", value);
@@ -117,11 +117,9 @@ bool_Object* new_bool(VM* vm, int bool_value) {
 /*
 Constructor for str_Object
 Returns a pointer to str_Object struct inheriting from PrimitiveObject.
-Value holds a mutable char pointer.
+The object and its length + 1 bytes of value come from a single allocation.
 */
-str_Object* new_str(const char* string_value) {
-    str_Object* obj = (str_Object*)malloc(sizeof(str_Object));
-    if (!obj) return NULL;
+static void init_str(str_Object* obj, size_t length) {
     obj->base.type = TYPE_str;
     obj->base.add = (BinaryOp)add_str;
     obj->base.mul = (BinaryOp)mul_str;
@@ -134,8 +132,84 @@ str_Object* new_str(const char* string_value) {
     obj->base.leq = leq_str;
     obj->base.lt  = lt_str;
     obj->base.__str__ = str_to_string;
-    obj->value = strdup(string_value); // This makes a copy of the string which always makes it mutable
+    obj->length = length;
+    obj->hash = 0;
+    obj->hashed = 0;
+    obj->interned = 0;
+    obj->depth = 0;
+    obj->storage = STR_CONCAT;
+    obj->value = NULL;
+    obj->left = NULL;
+    obj->right = NULL;
+}
+
+str_Object* alloc_str(size_t length) {
+    str_Object* obj = (str_Object*)malloc(sizeof(str_Object) + length + 1);
+    if (!obj) return NULL;
+    init_str(obj, length);
+    obj->storage = STR_INLINE;
+    obj->value = obj->data;
+    obj->value[length] = '\0';
+
+    return obj;
+}
+
+/*
+"" and the 256 one byte strings are created all the time (input, str(), single characters), so every request
+for them returns the same immortal instance. They count as interned, intern_str hands out the same objects.
+*/
+static str_Object* small_strs[257];
+
+static str_Object* small_str(const char* bytes, size_t length) {
+    size_t index = length ? 1 + (uint8_t)bytes[0] : 0;
+    if (!small_strs[index]) {
+        str_Object* obj = alloc_str(length);
+        if (!obj) return NULL;
+        memcpy(obj->value, bytes, length);
+        obj->interned = 1;
+        small_strs[index] = obj;
+    }
+    return small_strs[index];
+}
+
+str_Object* new_str_len(const char* bytes, size_t length) {
+    if (length <= 1) return small_str(bytes, length);
+
+    str_Object* obj = alloc_str(length);
+    if (!obj) return NULL;
+    memcpy(obj->value, bytes, length); // This makes a copy of the string
+    return obj;
+}
+
+str_Object* new_str(const char* string_value) {
+    return new_str_len(string_value, strlen(string_value));
+}
+
+uint64_t str_hash(str_Object* str) {
+    if (!str->hashed) {
+        str->hash = hashmap_hash(str_value(str), str->length);
+        str->hashed = 1;
+    }
+    return str->hash;
+}
 
+/*
+Returns the interned str_Object for bytes, creating it on first use.
+Interned strings live as long as the vm and are never freed by free_primitive.
+*/
+str_Object* intern_str(VM* vm, const char* bytes, size_t length) {
+    if (length <= 1) return small_str(bytes, length);
+
+    uint64_t h = hashmap_hash(bytes, length);
+    str_Object* obj = (str_Object*)hashmap_get_prehashed(vm->strings, bytes, length, h);
+    if (obj) return obj;
+
+    obj = new_str_len(bytes, length);
+    if (!obj) return NULL;
+    obj->hash = h;
+    obj->hashed = 1;
+    obj->interned = 1;
+    hashmap_set_prehashed(vm->strings, bytes, length, h, obj, NULL);
     return obj;
 }
 
@@ -174,8 +248,11 @@ void free_primitive(PrimitiveObject* object) {
 
     switch (object->type) {
         case TYPE_str:
-            free(((str_Object*)object)->value); // Free the allocated string
-            break;
+            if (((str_Object*)object)->interned) return; // owned by the intern table (or a shared small string)
+            if (((str_Object*)object)->storage == STR_HEAP) {
+                free(((str_Object*)object)->value); // bytes of a flattened concat node
+            }
+            break; // inline bytes are part of the object
         case TYPE_bool:
         case TYPE_Null:
             return; // Also just to be safe just incase free is ever called on Null or Bool
@@ -187,6 +264,196 @@ void free_primitive(PrimitiveObject* object) {
 } // keep in mind that this only frees the memory but does not set the ptr to null to prevent use after free
 
 
+/* //////////////////////  STRING ROPES  ////////////////////// */
+/*
+add_str returns concat nodes for long results so that `s = s + piece` in a loop does not copy s every time.
+The bytes are only materialised (once) when something reads them through str_value().
+Balancing follows Boehm, Atkinson and Plass, "Ropes: an Alternative to Strings".
+*/
+
+/* str_rope_min_len[d]: a rope of depth d is balanced if it is at least this long (fibonacci numbers) */
+static size_t str_rope_min_len[STR_ROPE_MAX_DEPTH + 2];
+
+static void init_rope_min_len(void) {
+    if (str_rope_min_len[0]) return;
+    size_t a = 1, b = 2;
+    for (int i = 0; i <= STR_ROPE_MAX_DEPTH; i++) {
+        str_rope_min_len[i] = a;
+        size_t next = a + b;
+        a = b;
+        b = next;
+    }
+    str_rope_min_len[STR_ROPE_MAX_DEPTH + 1] = SIZE_MAX;
+}
+
+static str_Object* make_concat(str_Object* left, str_Object* right) {
+    str_Object* node = (str_Object*)malloc(sizeof(str_Object));
+    if (!node) {
+        printf("Memory allocation for string addition failed.\n");
+        exit(EXIT_FAILURE);
+    }
+    init_str(node, left->length + right->length);
+    node->left = left;
+    node->right = right;
+    node->depth = 1 + (left->depth > right->depth ? left->depth : right->depth);
+    return node;
+}
+
+static void flatten_into(str_Object* str, char* out) {
+    if (str->storage != STR_CONCAT) {
+        memcpy(out, str->value, str->length);
+        return;
+    }
+    flatten_into(str->left, out);
+    flatten_into(str->right, out + str->left->length);
+}
+
+const char* str_value(str_Object* str) {
+    if (str->storage == STR_CONCAT) {
+        char* bytes = malloc(str->length + 1);
+        if (!bytes) {
+            printf("Memory allocation for string flattening failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        flatten_into(str, bytes);
+        bytes[str->length] = '\0';
+        str->value = bytes;
+        str->storage = STR_HEAP;
+        str->left = NULL; // the node now behaves like a flat string
+        str->right = NULL;
+        str->depth = 0;
+    }
+    return str->value;
+}
+
+/* Inserts a balanced piece into the forest, slot i holds a rope of length [min_len[i], min_len[i + 1]) */
+static void add_leaf_to_forest(str_Object* piece, str_Object** forest) {
+    str_Object* insertee = NULL;
+    int i;
+    for (i = 0; str_rope_min_len[i + 1] <= piece->length; i++) { // concatenate everything shorter than piece first
+        if (forest[i]) {
+            insertee = insertee ? make_concat(forest[i], insertee) : forest[i];
+            forest[i] = NULL;
+        }
+    }
+    insertee = insertee ? make_concat(insertee, piece) : piece;
+    for (;; i++) {
+        if (forest[i]) {
+            insertee = make_concat(forest[i], insertee);
+            forest[i] = NULL;
+        }
+        if (i == STR_ROPE_MAX_DEPTH || insertee->length < str_rope_min_len[i + 1]) {
+            forest[i] = insertee;
+            break;
+        }
+    }
+}
+
+/* Balanced subtrees are inserted as a whole, only the unbalanced parts of the rope are taken apart */
+static void add_to_forest(str_Object* rope, str_Object** forest) {
+    if (rope->storage != STR_CONCAT || rope->length >= str_rope_min_len[rope->depth]) {
+        add_leaf_to_forest(rope, forest);
+        return;
+    }
+    add_to_forest(rope->left, forest);
+    add_to_forest(rope->right, forest);
+}
+
+static str_Object* balance_str(str_Object* rope) {
+    str_Object* forest[STR_ROPE_MAX_DEPTH + 1] = {0};
+    str_Object* result = NULL;
+
+    add_to_forest(rope, forest);
+    for (int i = 0; i <= STR_ROPE_MAX_DEPTH; i++) { // lower slots hold the later parts of the string
+        if (forest[i]) {
+            result = result ? make_concat(forest[i], result) : forest[i];
+        }
+    }
+    if (result->depth > STR_ROPE_MAX_DEPTH) {
+        str_value(result); // should not happen, but a flat string is always acceptable
+    }
+    return result;
+}
+
+/* Concatenation of two strings whose combined length is at least STR_ROPE_MIN */
+static str_Object* concat_str(str_Object* left, str_Object* right) {
+    init_rope_min_len();
+
+    // appending a short string to a rope that ends in a short leaf: merge the two leaves instead of adding a node
+    if (right->storage != STR_CONCAT && left->storage == STR_CONCAT && left->right->storage != STR_CONCAT &&
+        left->right->length + right->length < STR_ROPE_MIN) {
+        str_Object* leaf = alloc_str(left->right->length + right->length);
+        if (!leaf) {
+            printf("Memory allocation for string addition failed.\n");
+            return NULL;
+        }
+        memcpy(leaf->value, left->right->value, left->right->length);
+        memcpy(leaf->value + left->right->length, right->value, right->length);
+        return make_concat(left->left, leaf);
+    }
+
+    str_Object* node = make_concat(left, right);
+    if (node->depth > STR_ROPE_MAX_DEPTH) {
+        node = balance_str(node);
+    }
+    return node;
+}
+
+/* //////////////////////  STRING VIEWS  ////////////////////// */
+/*
+s[a:b] does not copy: the result points into the bytes of s and keeps s (or the string s itself is a view of)
+referenced through left. Views are flat as far as every other string operation is concerned, only code handing
+the bytes to C functions that expect a NUL terminated string has to go through str_cstr().
+*/
+
+str_Object* slice_str(str_Object* str, size_t start, size_t end) {
+    size_t length = end - start;
+    if (length == str->length) return str;
+    const char* bytes = str_value(str);
+    if (length < STR_VIEW_MIN) return new_str_len(bytes + start, length);
+
+    str_Object* owner = str->storage == STR_VIEW ? str->left : str; // never chain views
+    str_Object* view = (str_Object*)malloc(sizeof(str_Object));
+    if (!view) {
+        printf("Memory allocation for string slice failed.\n");
+        return NULL;
+    }
+    init_str(view, length);
+    view->storage = STR_VIEW;
+    view->value = (char*)bytes + start;
+    view->left = owner;
+    return view;
+}
+
+str_Object* view_str(const char* bytes, size_t length) {
+    str_Object* view = (str_Object*)malloc(sizeof(str_Object));
+    if (!view) {
+        printf("Memory allocation for string view failed.\n");
+        return NULL;
+    }
+    init_str(view, length);
+    view->storage = STR_VIEW;
+    view->value = (char*)bytes;
+    view->left = NULL; // the bytes are not owned by a string (e.g. a file mapped by read_all)
+    return view;
+}
+
+const char* str_cstr(str_Object* str) {
+    if (str->storage == STR_VIEW) { // materialise once, the view then owns a NUL terminated copy
+        char* bytes = malloc(str->length + 1);
+        if (!bytes) {
+            printf("Memory allocation for string slice failed.\n");
+            exit(EXIT_FAILURE);
+        }
+        memcpy(bytes, str->value, str->length);
+        bytes[str->length] = '\0';
+        str->value = bytes;
+        str->storage = STR_HEAP;
+        str->left = NULL;
+    }
+    return str_value(str);
+}
+
 /* //////////////////////  PRIMITIVE OPERATORS  ////////////////////// */
 /* //////////////////////  OPERATOR: add  ////////////////////// */
 
@@ -262,25 +529,31 @@ PrimitiveObject* add_str(PrimitiveObject* self, PrimitiveObject* other) {
     if (!self || !other) return NULL;
 
     if (other->type == TYPE_str) {
-        char * str1 = ((str_Object *) self)->value;
-        char * str2 = ((str_Object *) other)->value;
+        str_Object * str1 = (str_Object *) self;
+        str_Object * str2 = (str_Object *) other;
 
-        size_t len1 = strlen(str1);
-        size_t len2 = strlen(str2);
-        if (len1 > SIZE_MAX - len2 - 1) { // Ensure that the concat operation is within bounds of a uint
+        size_t len1 = str1->length;
+        size_t len2 = str2->length;
+        if (len1 > SIZE_MAX - sizeof(str_Object) - len2 - 1) { // Ensure that the concat operation is within bounds of a uint
             printf("Error: String concatenation size exceeds limit.\n");
             return NULL;
         }
 
-        char * new_str_val = malloc(len1 + len2 + 1);
-        if (!new_str_val) {
+        // strings are immutable, so concatenating an empty string can return the other operand
+        if (len2 == 0) return self;
+        if (len1 == 0) return other;
+
+        // intended behaviour is for a new str to be instantiated when operators are applied onto it
+        if (len1 + len2 >= STR_ROPE_MIN) {
+            return (PrimitiveObject*)concat_str(str1, str2);
+        }
+        str_Object * res = alloc_str(len1 + len2); // both operands are shorter than STR_ROPE_MIN so they are flat
+        if (!res) {
             printf("Memory allocation for string addition failed.\n");
             return NULL;
         }
-        strcpy(new_str_val, str1);
-        strcat(new_str_val, str2);
-        str_Object * res = new_str(new_str_val); // constructor of str_Object duplicates new_str_val so must free it in next line
-        free(new_str_val);                       // intended behaviour is for a new str to be instantiated when operators are applied onto it
+        memcpy(res->value, str1->value, len1);
+        memcpy(res->value + len1, str2->value, len2);
         return (PrimitiveObject*)res;
     }
 
@@ -306,8 +579,7 @@ PrimitiveObject* mul_int(PrimitiveObject* self, PrimitiveObject* other) {
             return (PrimitiveObject*)new_int(self->vm, ((int_Object*)self)->value * ((int_Object*)other)->value);
 
         case TYPE_str: {
-            int i;
-            int n = ((int_Object*)self)->value;
+            int64_t n = ((int_Object*)self)->value;
 
             if (n < 0) {
                 printf("String multiplication not supported for negative numbers\n");
@@ -316,22 +588,30 @@ PrimitiveObject* mul_int(PrimitiveObject* self, PrimitiveObject* other) {
                 return (PrimitiveObject*)new_str(""); // Explicitly handle str * 0
             }
 
-            char* str1 = ((str_Object*)other)->value;  // other is the string
-            size_t len = strlen(str1) * n;
-            char* new_str_val = malloc(len + 1);
+            str_Object* str1 = (str_Object*)other;  // other is the string
+            if (str1->length && (uint64_t)n > (SIZE_MAX - sizeof(str_Object) - 1) / str1->length) {
+                printf("Error: String multiplication size exceeds limit.\n");
+                return NULL;
+            }
+            size_t len = str1->length * n;
+            if (len <= 1) {
+                return (PrimitiveObject*)new_str_len(str_value(str1), len); // shared small string
+            }
+            str_Object* res = alloc_str(len);
 
-            if (!new_str_val) {
+            if (!res) {
                 printf("Memory allocation for string multiplication failed.\n");
                 return NULL;
             }
 
-            new_str_val[0] = '\0';  // Initialize empty string
-            for (i = 0; i < n; i++) {
-                strcat(new_str_val, str1);
+            // one copy of the operand, then keep doubling what has been written so far
+            size_t filled = str1->length;
+            memcpy(res->value, str_value(str1), filled);
+            while (filled < len) {
+                size_t chunk = filled < len - filled ? filled : len - filled;
+                memcpy(res->value + filled, res->value, chunk);
+                filled += chunk;
             }
-
-            str_Object* res = new_str(new_str_val);
-            free(new_str_val);  // Safe to free since new_str duplicates it
             return (PrimitiveObject*)res;
         }
 
@@ -383,7 +663,7 @@ PrimitiveObject* mul_bool(PrimitiveObject* self, PrimitiveObject* other) {
             return (PrimitiveObject*)new_int(self->vm, ((bool_Object*)self)->value * ((int_Object*)other)->value);
 
         case TYPE_str:
-            return (PrimitiveObject*)(((bool_Object*)self)->value ? new_str(((str_Object*)other)->value) : new_str(""));
+            return (PrimitiveObject*)(((bool_Object*)self)->value ? new_str_len(str_value((str_Object*)other), ((str_Object*)other)->length) : new_str(""));
 
         case TYPE_Null:
             printf("Multiplication not supported between %s and %s\n",
@@ -669,13 +949,25 @@ int eq_bool(PrimitiveObject* self, PrimitiveObject* other) {
     }
 }
 
+/* Orders strings like strcmp, using the stored lengths instead of scanning for the terminator */
+static int compare_str(str_Object* a, str_Object* b) {
+    size_t shorter = a->length < b->length ? a->length : b->length;
+    int cmp = memcmp(str_value(a), str_value(b), shorter);
+    if (cmp != 0) return cmp;
+    return (a->length > b->length) - (a->length < b->length);
+}
+
 int eq_str(PrimitiveObject* self, PrimitiveObject* other) {
     if (other->type != TYPE_str) return 0;
+    if (self == other) return 1;
 
-    char* a_val = ((str_Object*)self)->value;
-    char* b_val = ((str_Object*)other)->value;
+    str_Object* a = (str_Object*)self;
+    str_Object* b = (str_Object*)other;
 
-    return strcmp(a_val, b_val) == 0;
+    if (a->length != b->length) return 0;
+    if (a->interned && b->interned) return 0; // distinct interned strings never hold the same bytes
+    if (a->hashed && b->hashed && a->hash != b->hash) return 0;
+    return memcmp(str_value(a), str_value(b), a->length) == 0;
 }
 
 int eq_NULL(PrimitiveObject* self, PrimitiveObject* other) {
@@ -737,10 +1029,7 @@ int geq_bool(PrimitiveObject* self, PrimitiveObject* other) {
 int geq_str(PrimitiveObject* self, PrimitiveObject* other) {
     if (other->type != TYPE_str) return 0;
 
-    char* a = ((str_Object*)self)->value;
-    char* b = ((str_Object*)other)->value;
-
-    return strcmp(a, b) >= 0;
+    return compare_str((str_Object*)self, (str_Object*)other) >= 0;
 }
 
 // /* //////////////////////  OPERATOR: !=  ////////////////////// */
@@ -818,10 +1107,7 @@ int gt_bool(PrimitiveObject* self, PrimitiveObject* other) {
 int gt_str(PrimitiveObject* self, PrimitiveObject* other) {
     if (other->type != TYPE_str) return 0;
 
-    char* a = ((str_Object*)self)->value;
-    char* b = ((str_Object*)other)->value;
-
-    return strcmp(a, b) > 0;
+    return compare_str((str_Object*)self, (str_Object*)other) > 0;
 }
 
 // /* //////////////////////  OPERATOR: <  ////////////////////// */
@@ -864,27 +1150,112 @@ int lt_bool(PrimitiveObject* self, PrimitiveObject* other) {
 int lt_str(PrimitiveObject* self, PrimitiveObject* other) {
     if (other->type != TYPE_str) return 0;
 
-    char* a = ((str_Object*)self)->value;
-    char* b = ((str_Object*)other)->value;
-
-    return strcmp(a, b) < 0;
+    return compare_str((str_Object*)self, (str_Object*)other) < 0;
 }
 
 // /* //////////////////////  __str__  ////////////////////// */
+/*
+Number formatting without snprintf. Integers are written two digits at a time from a table. Floats keep the
+"%lf" output (6 decimals, round half to even on the exact binary value): below 1e9 the value times 1e6 fits a
+uint64_t and fma gives the exact rounding error of that product, so the last digit is rounded exactly. Larger
+values, inf and nan go through snprintf.
+*/
+static const char digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static size_t format_uint64(uint64_t value, char* buffer) {
+    char digits[20];
+    char* p = digits + sizeof(digits);
+    while (value >= 100) {
+        p -= 2;
+        memcpy(p, digit_pairs + (value % 100) * 2, 2);
+        value /= 100;
+    }
+    if (value >= 10) {
+        p -= 2;
+        memcpy(p, digit_pairs + value * 2, 2);
+    } else {
+        *--p = (char)('0' + value);
+    }
+    size_t length = (size_t)(digits + sizeof(digits) - p);
+    memcpy(buffer, p, length);
+    return length;
+}
+
+static size_t format_int64(int64_t value, char* buffer) {
+    if (value < 0) {
+        buffer[0] = '-';
+        return 1 + format_uint64(0 - (uint64_t)value, buffer + 1);
+    }
+    return format_uint64((uint64_t)value, buffer);
+}
+
+static size_t format_double(double value, char* buffer) {
+    double magnitude = fabs(value);
+    if (!(magnitude < 1e9)) { // also catches nan
+        int written = snprintf(buffer, PRIMITIVE_FORMAT_MAX, "%lf", value);
+        if (written < 0) return 0;
+        return (size_t)written < PRIMITIVE_FORMAT_MAX ? (size_t)written : PRIMITIVE_FORMAT_MAX - 1; // truncated like before
+    }
+
+    double scaled = magnitude * 1e6;
+    double error = fma(magnitude, 1e6, -scaled); // magnitude * 1e6 == scaled + error exactly
+    double whole = floor(scaled);
+    double above_half = (scaled - whole - 0.5) + error;
+    uint64_t units = (uint64_t)whole;
+    if (above_half > 0 || (above_half == 0 && (units & 1))) {
+        units++;
+    }
+
+    size_t length = 0;
+    if (signbit(value)) {
+        buffer[length++] = '-';
+    }
+    length += format_uint64(units / 1000000, buffer + length);
+    uint64_t fraction = units % 1000000;
+    buffer[length] = '.';
+    memcpy(buffer + length + 1, digit_pairs + (fraction / 10000) * 2, 2);
+    memcpy(buffer + length + 3, digit_pairs + (fraction / 100 % 100) * 2, 2);
+    memcpy(buffer + length + 5, digit_pairs + (fraction % 100) * 2, 2);
+    return length + 7;
+}
+
+size_t format_primitive(PrimitiveObject* obj, char* buffer) {
+    size_t length;
+    switch (obj->type) {
+        case TYPE_int:
+            length = format_int64(((int_Object*)obj)->value, buffer);
+            break;
+        case TYPE_float:
+            length = format_double(((float_Object*)obj)->value, buffer);
+            break;
+        case TYPE_bool:
+            length = ((bool_Object*)obj)->value ? 4 : 5;
+            memcpy(buffer, ((bool_Object*)obj)->value ? "true" : "false", length);
+            break;
+        default:
+            length = 4;
+            memcpy(buffer, "NULL", length);
+            break;
+    }
+    buffer[length] = '\0';
+    return length;
+}
+
 char* int_to_string(PrimitiveObject* obj) {
-    int_Object* intObj = (int_Object*)obj;
-    char* buffer = malloc(32);  // enough for 64-bit integers
+    char* buffer = malloc(PRIMITIVE_FORMAT_MAX);
     if (buffer) {
-        snprintf(buffer, 32, "%ld", intObj->value);
+        format_primitive(obj, buffer);
     }
     return buffer;
 }
 
 char* float_to_string(PrimitiveObject* obj) {
-    float_Object* floatObj = (float_Object*)obj;
-    char* buffer = malloc(64);
+    char* buffer = malloc(PRIMITIVE_FORMAT_MAX);
     if (buffer) {
-        snprintf(buffer, 64, "%lf", floatObj->value);
+        format_primitive(obj, buffer);
     }
     return buffer;
 }
@@ -900,5 +1271,9 @@ char* null_to_string(PrimitiveObject* obj) {
 
 char* str_to_string(PrimitiveObject* obj) {
     str_Object* strObj = (str_Object*)obj;
-    return strdup(strObj->value); //copy so we don't free the value of the primitive (as technically thats the job of the garbage collector)
+    char* copy = malloc(strObj->length + 1); //copy so we don't free the value of the primitive (as technically thats the job of the garbage collector)
+    if (!copy) return NULL;
+    memcpy(copy, str_value(strObj), strObj->length);
+    copy[strObj->length] = '\0';
+    return copy;
 }
@@ -76,10 +76,37 @@ typedef struct bool_Object {
     int8_t value;
 } bool_Object;
 
-/* String object */
+#define STR_ROPE_MIN 256       // add_str returns a concat node (rope) once the result is at least this long
+#define STR_ROPE_MAX_DEPTH 45  // ropes deeper than this are rebalanced
+#define STR_VIEW_MIN 32        // shorter slices are copied, a view object is not smaller than the bytes it saves
+
+/* Where the bytes of a str_Object live */
+typedef enum {
+    STR_INLINE,  // right after the object, in the same allocation (every string created from bytes)
+    STR_HEAP,    // in a separate allocation (a concat node that has been flattened)
+    STR_CONCAT,  // not materialised yet: a concat node whose value is NULL
+    STR_VIEW,    // a slice pointing into the bytes of another string (left), not NUL terminated
+} StrStorage;
+
+/*
+String object. Flat strings have their bytes allocated together with the object, "" and the one byte strings
+are shared immortal instances. Concat nodes (ropes) only reference their two operands and are flattened on
+first use, so read the bytes through str_value() unless the string is known to be flat. Slices are views that
+share the bytes of the string they were taken from; their bytes are not NUL terminated, use str_cstr() when a
+C string is needed.
+*/
 typedef struct str_Object {
     PrimitiveObject base;
-    char* value; // immutable
+    size_t length;     // number of bytes (excluding the terminating NUL)
+    uint64_t hash;     // hashmap_hash of the bytes, only valid once hashed is set (see str_hash)
+    uint8_t hashed;
+    uint8_t interned;  // unique in the vm's intern table: two interned strings are equal only if they are the same object
+    uint8_t depth;     // 0 for flat strings, concat nodes: 1 + depth of the deeper operand
+    uint8_t storage;   // StrStorage
+    char* value;       // immutable, NUL terminated unless this is a view. NULL for a concat node that has not been flattened yet
+    struct str_Object* left;  // concat node operands, cleared once the node is flattened. A view keeps the string
+    struct str_Object* right; // that owns its bytes in left
+    char data[];       // bytes of a flat string (value points here)
 } str_Object;
 
 /* Null object (singleton) */
@@ -92,6 +119,14 @@ int_Object* new_int(VM* vm, int64_t value);
 float_Object* new_float(double value);
 bool_Object* new_bool(VM* vm, int bool_value);
 str_Object* new_str(const char* string_value);
+str_Object* new_str_len(const char* bytes, size_t length);
+str_Object* alloc_str(size_t length); // value is left for the caller to fill in (only the NUL terminator is set)
+str_Object* intern_str(VM* vm, const char* bytes, size_t length); // shared instance from the vm's intern table
+uint64_t str_hash(str_Object* str);   // computed on first use and cached
+const char* str_value(str_Object* str); // bytes of str, flattening a concat node first
+const char* str_cstr(str_Object* str);  // like str_value but always NUL terminated (a view is copied once)
+str_Object* slice_str(str_Object* str, size_t start, size_t end); // bytes [start, end), 0 <= start <= end <= length
+str_Object* view_str(const char* bytes, size_t length); // view of bytes that outlive the string, nothing is copied
 Null_Object* get_null(VM* vm); // Singleton instance
 
 /* Free functions */
@@ -164,6 +199,11 @@ PrimitiveObject* bitwise_OR(PrimitiveObject* self, PrimitiveObject* other);
 PrimitiveObject* bitwise_RSHIFT(PrimitiveObject* self, PrimitiveObject* other);
 PrimitiveObject* bitwise_LSHIFT(PrimitiveObject* self, PrimitiveObject* other);
 
+/* __str__ into a caller buffer: writes the text of a non-str primitive into buffer (at most PRIMITIVE_FORMAT_MAX
+bytes including the NUL terminator) without allocating. Returns the number of bytes written, excluding the NUL. */
+#define PRIMITIVE_FORMAT_MAX 64
+size_t format_primitive(PrimitiveObject* obj, char* buffer);
+
 /* PrimitiveObject __str__ */
 char* int_to_string(PrimitiveObject* self);
 char* float_to_string(PrimitiveObject* self);
@@ -0,0 +1,73 @@
+/*
+Number printing benchmark (build with `make format_bench`).
+
+Prints FORMAT_BENCH_COUNT ints and floats to /dev/null the way OP_PRINT used to (snprintf into a malloc'd
+__str__ buffer, then printf) and the way it does now (format_primitive into a stack buffer, then fwrite).
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "core_primitives.h"
+
+#define FORMAT_BENCH_COUNT 10000000
+
+static double seconds_since(struct timespec start) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)(now.tv_sec - start.tv_sec) + (double)(now.tv_nsec - start.tv_nsec) / 1e9;
+}
+
+static void print_snprintf(FILE* out, PrimitiveObject* obj) {
+    char* repr = malloc(64);
+    if (obj->type == TYPE_int) {
+        snprintf(repr, 64, "%ld", ((int_Object*)obj)->value);
+    } else {
+        snprintf(repr, 64, "%lf", ((float_Object*)obj)->value);
+    }
+    fprintf(out, "%s\n", repr);
+    free(repr);
+}
+
+static void print_formatted(FILE* out, PrimitiveObject* obj) {
+    char repr[PRIMITIVE_FORMAT_MAX + 1];
+    size_t length = format_primitive(obj, repr);
+    repr[length] = '\n';
+    fwrite(repr, 1, length + 1, out);
+}
+
+static void run_bench(FILE* out, const char* name, void (*print)(FILE*, PrimitiveObject*), PrimitiveObject* obj) {
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    uint64_t state = 0x9e3779b97f4a7c15ULL;
+    for (size_t i = 0; i < FORMAT_BENCH_COUNT; i++) {
+        state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+        if (obj->type == TYPE_int) {
+            ((int_Object*)obj)->value = (int64_t)(state >> (state & 63)); // mix of short and long numbers
+        } else {
+            ((float_Object*)obj)->value = (double)(int64_t)(state >> 24) / 4096.0;
+        }
+        print(out, obj);
+    }
+    printf("%-24s %6.1f ns/number\n", name, seconds_since(start) * 1e9 / FORMAT_BENCH_COUNT);
+}
+
+int main(void) {
+    FILE* out = fopen("/dev/null", "w");
+    if (!out) {
+        printf("Error: Could not open /dev/null.\n");
+        return 1;
+    }
+    int_Object integer;
+    memset(&integer, 0, sizeof(integer));
+    integer.base.type = TYPE_int;
+    float_Object* real = new_float(0.0);
+
+    run_bench(out, "int snprintf", print_snprintf, (PrimitiveObject*)&integer);
+    run_bench(out, "int format_primitive", print_formatted, (PrimitiveObject*)&integer);
+    run_bench(out, "float snprintf", print_snprintf, (PrimitiveObject*)real);
+    run_bench(out, "float format_primitive", print_formatted, (PrimitiveObject*)real);
+
+    fclose(out);
+    return 0;
+}
@@ -0,0 +1,19 @@
+#ifndef NUMBER_PARSE_H
+#define NUMBER_PARSE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Number parsing for int() and float() (OP_PARSEINT / OP_PARSEFLOAT).
+
+Both accept exactly what strtoll(text, &end, 10) / strtod(text, &end) accept with *end == '\0', and return the
+same values: plain decimal input takes the fast paths, everything else (leading whitespace, hex floats, inf/nan,
+very long or out of range numbers) is handed to strtoll/strtod. text[length] must be '\0'.
+Both return 1 and set *value on success, 0 if text is not a valid number.
+*/
+
+int parse_int64(const char *text, size_t length, int64_t *value);
+int parse_double(const char *text, size_t length, double *value);
+
+#endif
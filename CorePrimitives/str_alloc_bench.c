@@ -0,0 +1,68 @@
+/*
+Allocation count benchmark for small strings (build with `make str_alloc_bench`, linux only: malloc is
+wrapped with the linker's --wrap option).
+
+Each workload creates STR_BENCH_OPS strings the way the vm does and reports the malloc calls and bytes
+per string. Flat strings cost one allocation (object and bytes together), "" and one byte strings none.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "core_primitives.h"
+
+#define STR_BENCH_OPS 1000000
+
+static size_t malloc_calls = 0;
+static size_t malloc_bytes = 0;
+
+void *__real_malloc(size_t size);
+
+void *__wrap_malloc(size_t size) {
+    malloc_calls++;
+    malloc_bytes += size;
+    return __real_malloc(size);
+}
+
+static void report(const char *name) {
+    printf("%-28s %6.2f mallocs/string %8.1f bytes/string\n", name,
+           (double)malloc_calls / STR_BENCH_OPS, (double)malloc_bytes / STR_BENCH_OPS);
+    malloc_calls = 0;
+    malloc_bytes = 0;
+}
+
+int main(void) {
+    static const char text[] = "the quick brown fox jumps over the lazy dog";
+    static const char *labels[] = {"id", "name", "count", "total_sum", "left", "right", "node_7", "x"};
+    char buffer[32];
+
+    str_Object *digit = new_str("7");
+    malloc_calls = 0;
+    malloc_bytes = 0;
+
+    // single characters, e.g. iterating over the characters of an input line
+    for (size_t i = 0; i < STR_BENCH_OPS; i++) {
+        new_str_len(text + i % (sizeof(text) - 1), 1);
+    }
+    report("one byte strings");
+
+    // short keys and labels (under 16 bytes)
+    for (size_t i = 0; i < STR_BENCH_OPS; i++) {
+        new_str(labels[i % 8]);
+    }
+    report("labels");
+
+    // label + digit, as built by `name + str(i % 10)`
+    for (size_t i = 0; i < STR_BENCH_OPS; i++) {
+        add_str((PrimitiveObject *)new_str(labels[i % 8]), (PrimitiveObject *)digit);
+    }
+    report("label + digit (2 strings)");
+
+    // numbers formatted into a buffer, like OP_INPUT does with each line
+    for (size_t i = 0; i < STR_BENCH_OPS; i++) {
+        size_t length = (size_t)snprintf(buffer, sizeof(buffer), "%zu", i % 100);
+        new_str_len(buffer, length);
+    }
+    report("input lines of 1-2 bytes");
+
+    return 0;
+}
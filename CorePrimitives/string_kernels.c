@@ -0,0 +1,221 @@
+#include "string_kernels.h"
+#include <string.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SK_X86
+#include <immintrin.h>
+#endif
+
+/*
+Substring search uses the "first and last byte" filter (W. Mula, SIMD-friendly algorithms for substring searching):
+compare a block of candidate start positions against the needle's first byte and the same block shifted by
+needle_length - 1 against its last byte, then only memcmp the middle of the positions where both match.
+Case conversion flips bit 0x20 of the bytes inside 'A'..'Z' (or 'a'..'z'), found with one signed compare.
+*/
+
+/* ///////////////////////// SCALAR ///////////////////////// */
+
+static size_t find_scalar(const char *haystack, size_t length, const char *needle, size_t needle_length, size_t start) {
+    if (start > length || needle_length > length - start) return SK_NOT_FOUND;
+    if (needle_length == 0) return start;
+
+    const char *p = haystack + start;
+    const char *last = haystack + length - needle_length; // last possible start of a match
+    while (p <= last) {
+        p = memchr(p, needle[0], (size_t)(last - p) + 1);
+        if (!p) return SK_NOT_FOUND;
+        if (memcmp(p + 1, needle + 1, needle_length - 1) == 0) return (size_t)(p - haystack);
+        p++;
+    }
+    return SK_NOT_FOUND;
+}
+
+static size_t count_byte_scalar(const char *haystack, size_t length, char byte) {
+    size_t count = 0;
+    for (size_t i = 0; i < length; i++) {
+        count += haystack[i] == byte;
+    }
+    return count;
+}
+
+/* flips the case of bytes in [from, from + 25] */
+static void convert_case_scalar(char *dst, const char *src, size_t length, char from) {
+    for (size_t i = 0; i < length; i++) {
+        char c = src[i];
+        dst[i] = (unsigned char)(c - from) < 26 ? (char)(c ^ 0x20) : c;
+    }
+}
+
+/* ///////////////////////// SSE2 ///////////////////////// */
+#ifdef SK_X86
+
+__attribute__((target("sse2")))
+static size_t find_sse2(const char *haystack, size_t length, const char *needle, size_t needle_length, size_t start) {
+    if (needle_length < 2 || start > length || needle_length > length - start) {
+        return find_scalar(haystack, length, needle, needle_length, start); // memchr already is vectorised
+    }
+    const __m128i first = _mm_set1_epi8(needle[0]);
+    const __m128i last = _mm_set1_epi8(needle[needle_length - 1]);
+
+    size_t i = start;
+    for (; i + needle_length - 1 + 16 <= length; i += 16) {
+        __m128i block_first = _mm_loadu_si128((const __m128i *)(haystack + i));
+        __m128i block_last = _mm_loadu_si128((const __m128i *)(haystack + i + needle_length - 1));
+        uint32_t mask = (uint32_t)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(block_first, first), _mm_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            size_t candidate = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(haystack + candidate + 1, needle + 1, needle_length - 2) == 0) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(haystack, length, needle, needle_length, i);
+}
+
+__attribute__((target("sse2")))
+static size_t count_byte_sse2(const char *haystack, size_t length, char byte) {
+    const __m128i target = _mm_set1_epi8(byte);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(haystack + i));
+        count += (size_t)__builtin_popcount((uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(block, target)));
+    }
+    return count + count_byte_scalar(haystack + i, length - i, byte);
+}
+
+__attribute__((target("sse2")))
+static void convert_case_sse2(char *dst, const char *src, size_t length, char from) {
+    const __m128i shift = _mm_set1_epi8((char)(128 - (unsigned char)from)); // moves `from` to -128
+    const __m128i bound = _mm_set1_epi8(-128 + 26);
+    const __m128i flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        __m128i block = _mm_loadu_si128((const __m128i *)(src + i));
+        __m128i in_range = _mm_cmplt_epi8(_mm_add_epi8(block, shift), bound);
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(block, _mm_and_si128(in_range, flip)));
+    }
+    convert_case_scalar(dst + i, src + i, length - i, from);
+}
+
+/* ///////////////////////// AVX2 ///////////////////////// */
+
+__attribute__((target("avx2")))
+static size_t find_avx2(const char *haystack, size_t length, const char *needle, size_t needle_length, size_t start) {
+    if (needle_length < 2 || start > length || needle_length > length - start) {
+        return find_scalar(haystack, length, needle, needle_length, start);
+    }
+    const __m256i first = _mm256_set1_epi8(needle[0]);
+    const __m256i last = _mm256_set1_epi8(needle[needle_length - 1]);
+
+    size_t i = start;
+    for (; i + needle_length - 1 + 32 <= length; i += 32) {
+        __m256i block_first = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        __m256i block_last = _mm256_loadu_si256((const __m256i *)(haystack + i + needle_length - 1));
+        uint32_t mask = (uint32_t)_mm256_movemask_epi8(
+            _mm256_and_si256(_mm256_cmpeq_epi8(block_first, first), _mm256_cmpeq_epi8(block_last, last)));
+        while (mask) {
+            size_t candidate = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(haystack + candidate + 1, needle + 1, needle_length - 2) == 0) return candidate;
+            mask &= mask - 1;
+        }
+    }
+    return find_sse2(haystack, length, needle, needle_length, i);
+}
+
+__attribute__((target("avx2")))
+static size_t count_byte_avx2(const char *haystack, size_t length, char byte) {
+    const __m256i target = _mm256_set1_epi8(byte);
+    size_t count = 0;
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(haystack + i));
+        count += (size_t)__builtin_popcount((uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, target)));
+    }
+    return count + count_byte_sse2(haystack + i, length - i, byte);
+}
+
+__attribute__((target("avx2")))
+static void convert_case_avx2(char *dst, const char *src, size_t length, char from) {
+    const __m256i shift = _mm256_set1_epi8((char)(128 - (unsigned char)from));
+    const __m256i bound = _mm256_set1_epi8(-128 + 26);
+    const __m256i flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= length; i += 32) {
+        __m256i block = _mm256_loadu_si256((const __m256i *)(src + i));
+        __m256i in_range = _mm256_cmpgt_epi8(bound, _mm256_add_epi8(block, shift));
+        _mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(block, _mm256_and_si256(in_range, flip)));
+    }
+    convert_case_sse2(dst + i, src + i, length - i, from);
+}
+
+#endif
+/* ///////////////////////// DISPATCH ///////////////////////// */
+
+typedef size_t (*FindFn)(const char *, size_t, const char *, size_t, size_t);
+typedef size_t (*CountByteFn)(const char *, size_t, char);
+typedef void (*ConvertCaseFn)(char *, const char *, size_t, char);
+
+static struct {
+    int ready;
+    StringKernelLevel level;
+    FindFn find;
+    CountByteFn count_byte;
+    ConvertCaseFn convert_case;
+} kernels;
+
+static void select_kernels(void) {
+    kernels.level = SK_SCALAR;
+    kernels.find = find_scalar;
+    kernels.count_byte = count_byte_scalar;
+    kernels.convert_case = convert_case_scalar;
+#ifdef SK_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.level = SK_AVX2;
+        kernels.find = find_avx2;
+        kernels.count_byte = count_byte_avx2;
+        kernels.convert_case = convert_case_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        kernels.level = SK_SSE2;
+        kernels.find = find_sse2;
+        kernels.count_byte = count_byte_sse2;
+        kernels.convert_case = convert_case_sse2;
+    }
+#endif
+    kernels.ready = 1;
+}
+
+StringKernelLevel string_kernel_level(void) {
+    if (!kernels.ready) select_kernels();
+    return kernels.level;
+}
+
+size_t sk_find(const char *haystack, size_t length, const char *needle, size_t needle_length, size_t start) {
+    if (!kernels.ready) select_kernels();
+    return kernels.find(haystack, length, needle, needle_length, start);
+}
+
+size_t sk_count(const char *haystack, size_t length, const char *needle, size_t needle_length) {
+    if (!kernels.ready) select_kernels();
+    if (needle_length == 0) return length + 1;
+    if (needle_length == 1) return kernels.count_byte(haystack, length, needle[0]);
+
+    size_t count = 0;
+    size_t pos = kernels.find(haystack, length, needle, needle_length, 0);
+    while (pos != SK_NOT_FOUND) {
+        count++;
+        pos = kernels.find(haystack, length, needle, needle_length, pos + needle_length);
+    }
+    return count;
+}
+
+void sk_upper(char *dst, const char *src, size_t length) {
+    if (!kernels.ready) select_kernels();
+    kernels.convert_case(dst, src, length, 'a');
+}
+
+void sk_lower(char *dst, const char *src, size_t length) {
+    if (!kernels.ready) select_kernels();
+    kernels.convert_case(dst, src, length, 'A');
+}
@@ -0,0 +1,33 @@
+#ifndef STRING_KERNELS_H
+#define STRING_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+Byte string kernels used by the string builtins (vm/builtins.c).
+On x86 the AVX2 or SSE2 version is picked at runtime (the first call detects the cpu), everything else uses the
+scalar version. None of the kernels need NUL terminated input.
+*/
+
+#define SK_NOT_FOUND SIZE_MAX
+
+typedef enum {
+    SK_SCALAR,
+    SK_SSE2,
+    SK_AVX2,
+} StringKernelLevel;
+
+StringKernelLevel string_kernel_level(void);
+
+// Index of the first occurrence of needle in haystack at or after start, SK_NOT_FOUND if there is none
+size_t sk_find(const char *haystack, size_t length, const char *needle, size_t needle_length, size_t start);
+
+// Number of non-overlapping occurrences of needle (an empty needle occurs length + 1 times, like python)
+size_t sk_count(const char *haystack, size_t length, const char *needle, size_t needle_length);
+
+// Writes the ascii upper/lower case version of src into dst (length bytes, dst may equal src)
+void sk_upper(char *dst, const char *src, size_t length);
+void sk_lower(char *dst, const char *src, size_t length);
+
+#endif
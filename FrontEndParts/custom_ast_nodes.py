@@ -85,6 +85,27 @@ class CallExpr(ASTNode):    # Specifically for function call expression
     def __repr__(self):
         return f"CallExpr({self.callee}, {self.arguments})"
 
+class IndexExpr(ASTNode):   # Indexing e.g. s[i]
+    def __init__(self, target, index):
+        self.target = target
+        self.index = index
+    def __repr__(self):
+        return f"IndexExpr({self.target}, {self.index})"
+
+class SliceExpr(ASTNode):   # Slicing e.g. s[a:b], start and end are None when omitted
+    def __init__(self, target, start, end):
+        self.target = target
+        self.start = start
+        self.end = end
+    def __repr__(self):
+        return f"SliceExpr({self.target}, {self.start}, {self.end})"
+
+class FormatExpr(ASTNode):  # f-string e.g. f"hello {name}!", parts are string Literals and expressions in order
+    def __init__(self, parts):
+        self.parts = parts
+    def __repr__(self):
+        return f"FormatExpr({self.parts})"
+
 class Assignment(ASTNode):  # Assignment operation e.g. a = 5
     def __init__(self, left, right, top_level_assignment=False):
         self.left = left
@@ -101,6 +122,14 @@ class FunctionDecl(ASTNode):
     def __repr__(self):
         return f"FunctionDecl({self.name}, {self.params}, {self.body})"
     
+class ExternDecl(ASTNode):  # Native function declaration e.g. extern fn dot(a, b) from "./libkernels.so";
+    def __init__(self, name, params, library):
+        self.name = name
+        self.params = params
+        self.library = library
+    def __repr__(self):
+        return f"ExternDecl({self.name}, {self.params}, {self.library})"
+
 class ReturnStmt(ASTNode):
     def __init__(self, expr):
         self.expr = expr
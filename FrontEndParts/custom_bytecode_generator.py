@@ -1,26 +1,55 @@
 from custom_ast_nodes import *
 
+MAX_LOCALS = 1024    # Must match MAX_LOCALS in vm/stackframe.h
+FUNC_HEADER_SIZE = 5 # OP_FUNCDEF, NUMARGS, NUMVARS, FUNCFLAGS, IDFUNC
+FUNC_FLAG_PURE = 1   # Must match FUNC_FLAG_PURE in vm/vm.h
+
+class InlineInstr:
+    """
+    A single instruction used by the inlining pass. Jump instructions keep a reference to the
+    instruction they land on (instead of a byte offset) so code can be spliced freely and the
+    offsets recomputed afterwards.
+    """
+    def __init__(self, text, target=None):
+        self.text = text
+        self.target = target        # InlineInstr the jump lands on (None if not a jump)
+        self.replaced_by = None     # Set when this instruction is removed, jumps landing here follow it
+
+    def resolve(self):
+        instr = self
+        while instr.replaced_by is not None:
+            instr = instr.replaced_by
+        return instr
+
 class BytecodeGenerator:
-    def __init__(self):
+    def __init__(self, inline_max_size=64, inline_max_depth=2):
         self.bytecodes = []          # Active instruction list for current scope.
         self.func_bytecodes = {}     # Mapping: function name -> function definition instruction list.
+        self.func_meta = {}          # Mapping: function name -> {num_args, num_locals, stack_clean} used by the inlining pass.
         self.in_function = False     # Flag indicating if we are in a function.
         self.locals = None           # For function scope: maps variable name -> local index.
+        self.inline_max_size = inline_max_size      # Largest callee body (in bytes) that will be inlined. 0 disables inlining.
+        self.inline_max_depth = inline_max_depth    # How many levels of inlined calls may be nested inside one another.
 
     # =============================== HElper functions ===============================
     def get_instruction_size(self, instruction):
         """
         Compute the size (in bytes) of a single instruction line based on the starting opcode.
+        Jump offsets in the IR are always measured in the standard encoding below. With -compact, compile_ir
+        re-encodes INT, STR, LOCAL, OP_FORMAT and jump operands as LEB128 (and uses the short opcodes INT8,
+        OP_JMP_SHORT, OP_JMPIF_SHORT, LOCAL_0..7 where they fit), moving every jump to its new offset itself.
         Standard size:
          - "INT <value>": 1 (opcode) + 8 (value) = 9 bytes.
          - "FLOAT <value>": 1 + 8.
          - "BOOL <value>": 1 + 1.
          - "STR <len> <string>": 1 (opcode) + 4 (length field) + (len) bytes.
-         - "ID <num> <name>": 1 (opcode) + 2 (num field) + (num) bytes.
-         - "IDFUNC <num> <name>": 1 + 2 + (num) bytes.
+         - "ID <num> <name>": 1 (opcode) + 2 (num field) + 8 (precomputed hash) + (num) bytes.
+         - "IDFUNC <num> <name>": 1 + 2 + 8 + (num) bytes.
          - "LOCAL <index>": 1 + 2
+         - "OP_FORMAT <count>": 1 + 2
          - Jump instructions ("OP_JMP" and "OP_JMPIF"): 1 (opcode) + 4 (offset) = 5 bytes.
-         - "NUMARGS"/"NUMVARS": 1 + 4 = 5 bytes.
+         - "NUMARGS"/"NUMVARS"/"FUNCFLAGS": 2 bytes (a field of the function header, no opcode).
+         - "__NULL__": 1 byte.
          - All other OP_* with no arguments: 1 byte.
         """
         tokens = instruction.split()
@@ -43,11 +72,15 @@ class BytecodeGenerator:
                     num = int(tokens[1])
                 except:
                     num = 0
-                return 1 + 2 + num
-            case "LOCAL":
+                return 1 + 2 + 8 + num
+            case "LOCAL" | "OP_FORMAT":
                 return 1 + 2
-            case "OP_JMP" | "OP_JMPIF" | "NUMARGS" | "NUMVARS":
+            case "OP_JMP" | "OP_JMPIF":
                 return 1 + 4
+            case "NUMARGS" | "NUMVARS" | "FUNCFLAGS":
+                return 2
+            case "__NULL__":
+                return 1
             case _:
                 if opcode.startswith("OP_"):
                     return 1
@@ -147,6 +180,163 @@ class BytecodeGenerator:
         self.locals[var_name] = idx
         return idx
 
+    def leaves_stack_clean(self, node):
+        # An expression statement that is not a call/input/parse leaves its value on the stack. A real call
+        # discards that when its frame is torn down but inlined code has no frame, so such functions are not inlined.
+        if isinstance(node, ExpressionStmt) and node.expr.__class__.__name__ not in (
+                "CallExpr", "InputStmt", "ParseInt", "ParseFloat", "ParseBool", "ParseStr"):
+            return False
+        if isinstance(node, ASTNode):
+            for attr in vars(node).values():
+                children = attr if isinstance(attr, list) else [attr]
+                for child in children:
+                    if isinstance(child, ASTNode) and not self.leaves_stack_clean(child):
+                        return False
+        return True
+
+    # =============================== Inlining pass ===============================
+    # Replaces `IDFUNC <name>` + `OP_CALL` inside function bodies with the body of small, non-recursive callees.
+    #  - The callee's LOCAL indices are shifted past the caller's own locals (NUMVARS of the caller grows to match).
+    #  - Arguments already on the stack are popped into those locals with LOCAL/OP_SET_LOCAL, last argument first.
+    #  - Every OP_RETURN becomes an OP_JMP to the instruction following the call (the join point), leaving the
+    #    return value on the stack exactly as OP_RETURN would. A trailing OP_RETURN simply falls through.
+    # Top level code runs without a stack frame, so calls from the main execution section are left as OP_CALL.
+    def link_instructions(self, code, end):
+        # Convert relative jump offsets into references to the instruction being jumped to.
+        items = [InlineInstr(instruction) for instruction in code]
+        positions = {}
+        pos = 0
+        for item in items:
+            positions[pos] = item
+            pos += self.get_instruction_size(item.text)
+        total = pos
+        pos = 0
+        for item in items:
+            size = self.get_instruction_size(item.text)
+            tokens = item.text.split()
+            if tokens[0] in ("OP_JMP", "OP_JMPIF"):
+                target_pos = pos + size + int(tokens[1])
+                item.target = end if target_pos == total else positions[target_pos]
+            pos += size
+        return items
+
+    def unlink_instructions(self, items, end):
+        # Recompute relative jump offsets from instruction references.
+        positions = {}
+        pos = 0
+        for item in items:
+            positions[id(item)] = pos
+            pos += self.get_instruction_size(item.text)
+        positions[id(end)] = pos
+        code = []
+        for item in items:
+            if item.target is not None:
+                opcode = item.text.split()[0]
+                offset = positions[id(item.target.resolve())] - (positions[id(item)] + 5)
+                code.append(f"{opcode} {offset}")
+            else:
+                code.append(item.text)
+        return code
+
+    def inline_call(self, callee, base, join):
+        # Produce the instruction sequence that replaces a call to callee, with its locals starting at base.
+        meta = self.func_meta[callee]
+        callee_end = InlineInstr(None)
+        callee_items = self.link_instructions(self.func_bytecodes[callee][FUNC_HEADER_SIZE:-1], callee_end)
+        callee_end.replaced_by = join
+
+        sequence = []
+        for i in reversed(range(meta["num_args"])):
+            sequence.append(InlineInstr(f"LOCAL {base + i}"))
+            sequence.append(InlineInstr("OP_SET_LOCAL"))
+        for i, item in enumerate(callee_items):
+            tokens = item.text.split()
+            if tokens[0] == "LOCAL":
+                item.text = f"LOCAL {base + int(tokens[1])}"
+            elif tokens[0] == "OP_RETURN":
+                if i == len(callee_items) - 1:
+                    item.replaced_by = join # final return just falls through to the join point
+                    continue
+                item.text = "OP_JMP 0"
+                item.target = join
+            sequence.append(item)
+        return sequence
+
+    def inline_functions(self):
+        # Build the call graph from the generated function bodies.
+        calls = {}
+        for name, code in self.func_bytecodes.items():
+            calls[name] = [instr.split()[2] for instr in code[FUNC_HEADER_SIZE:-1] if instr.startswith("IDFUNC ")]
+
+        def reaches(start, goal):
+            seen = set()
+            pending = list(calls.get(start, []))
+            while pending:
+                name = pending.pop()
+                if name == goal:
+                    return True
+                if name not in seen and name in calls:
+                    seen.add(name)
+                    pending.extend(calls[name])
+            return False
+
+        recursive = {name for name in calls if reaches(name, name)}
+        depth = {name: 0 for name in calls}
+
+        # Visit callees before callers so that a callee's body already has its own calls inlined.
+        order = []
+        visited = set()
+        def postorder(name):
+            if name in visited or name not in calls:
+                return
+            visited.add(name)
+            for callee in calls[name]:
+                postorder(callee)
+            order.append(name)
+        for name in calls:
+            postorder(name)
+
+        for caller in order:
+            code = self.func_bytecodes[caller]
+            header, body = code[:FUNC_HEADER_SIZE], code[FUNC_HEADER_SIZE:-1]
+            num_locals = self.func_meta[caller]["num_locals"]
+            caller_end = InlineInstr(None)
+            items = self.link_instructions(body, caller_end)
+            bases = {}  # callee name -> first local index of its slots in this caller
+            result = []
+            i = 0
+            while i < len(items):
+                item = items[i]
+                tokens = item.text.split()
+                callee = tokens[2] if tokens[0] == "IDFUNC" else None
+                if (callee is not None and callee in self.func_meta and callee not in recursive
+                        and callee != caller and self.func_meta[callee]["stack_clean"]
+                        and i + 1 < len(items) and items[i + 1].text == "OP_CALL"
+                        and self.compute_size(self.func_bytecodes[callee][FUNC_HEADER_SIZE:-1]) <= self.inline_max_size
+                        and depth[callee] + 1 <= self.inline_max_depth):
+                    if callee not in bases:
+                        if num_locals + self.func_meta[callee]["num_locals"] > MAX_LOCALS:
+                            result.append(item)
+                            i += 1
+                            continue
+                        bases[callee] = num_locals
+                        num_locals += self.func_meta[callee]["num_locals"]
+                    join = items[i + 2] if i + 2 < len(items) else caller_end
+                    sequence = self.inline_call(callee, bases[callee], join)
+                    item.replaced_by = sequence[0]
+                    items[i + 1].replaced_by = sequence[0]
+                    result.extend(sequence)
+                    depth[caller] = max(depth[caller], depth[callee] + 1)
+                    i += 2
+                    continue
+                result.append(item)
+                i += 1
+
+            if bases:
+                header = header[:2] + [f"NUMVARS {num_locals}"] + header[3:]
+                self.func_meta[caller]["num_locals"] = num_locals
+                self.func_bytecodes[caller] = header + self.unlink_instructions(result, caller_end) + [code[-1]]
+
     # =============================== Bytecode Generation ===============================
     def generate(self, ast):
         """
@@ -157,6 +347,8 @@ class BytecodeGenerator:
         self.in_function = False
         self.bytecodes = []
         self.visit(ast)
+        if self.inline_max_size > 0 and self.inline_max_depth > 0:
+            self.inline_functions()
         main_code = self.bytecodes.copy()
         main_code.append("OP_HALT")
         func_defs = []
@@ -297,6 +489,27 @@ class BytecodeGenerator:
             raise Exception(f"Unknown binary operator {node.op}")
         self.bytecodes.append(op_instr)
 
+    def visit_IndexExpr(self, node):
+        self.visit(node.target)
+        self.visit(node.index)
+        self.bytecodes.append("OP_INDEX")
+
+    def visit_SliceExpr(self, node):
+        # Omitted bounds are pushed as NULL, OP_SLICE uses the start/end of the string for them
+        self.visit(node.target)
+        for bound in (node.start, node.end):
+            if bound is None:
+                self.bytecodes.append("__NULL__")
+            else:
+                self.visit(bound)
+        self.bytecodes.append("OP_SLICE")
+
+    def visit_FormatExpr(self, node):
+        # Every part is pushed in order, OP_FORMAT joins them into one string with a single allocation
+        for part in node.parts:
+            self.visit(part)
+        self.bytecodes.append(f"OP_FORMAT {len(node.parts)}")
+
     def visit_UnaryOp(self, node):
         if node.op == '-':
             self.bytecodes.append("INT 0")
@@ -364,15 +577,28 @@ class BytecodeGenerator:
         funcheader.append("OP_FUNCDEF")
         funcheader.append(f"NUMARGS {num_args}")
         funcheader.append(f"NUMVARS {num_locals}")
+        funcheader.append(f"FUNCFLAGS {FUNC_FLAG_PURE if getattr(node, 'is_pure', False) else 0}")
         funcheader.append(f"IDFUNC {len(node.name.name)} {node.name.name}")
         funcheader.extend(func_body)
         funcheader.append("OP_ENDFUNC")
         self.func_bytecodes[node.name.name] = funcheader
+        self.func_meta[node.name.name] = {
+            "num_args": num_args,
+            "num_locals": num_locals,
+            "stack_clean": self.leaves_stack_clean(node.body),
+        }
         # reset for next function
         self.in_function = False
         self.locals = None
         self.bytecodes = original_bytecodes
 
+    def visit_ExternDecl(self, node):
+        # OP_EXTERN pops the argument count, function id and library path, loads the library and checks the function exists
+        self.bytecodes.append(f"STR {len(node.library)} {node.library}")
+        self.bytecodes.append(f"IDFUNC {len(node.name.name)} {node.name.name}")
+        self.bytecodes.append(f"INT {len(node.params)}")
+        self.bytecodes.append("OP_EXTERN")
+
     def visit_ReturnStmt(self, node):
         self.visit(node.expr)
         self.bytecodes.append("OP_RETURN")
@@ -14,12 +14,13 @@ class Lexer:
     def __init__(self, code):
         self.code = code
         self.line = 1
-        self.keywords = {"if", "else", "while", "return", "fn", "var", "loop", "from", "print", "input", "NULL", "int", "float", "str", "bool"}
+        self.keywords = {"if", "else", "while", "return", "fn", "var", "loop", "from", "print", "input", "NULL", "int", "float", "str", "bool", "extern"}
         self.token_specification = [
             ('MANY_LINE_COMMENT', r'///(.*)///'),   # Greedy match for multi-line comments
             ('ONE_LINE_COMMENT',  r'//[^\n]*'),      # Match until newline only
             ('FLOAT',             r'\d+\.\d+'),
             ('INTEGER',           r'\d+'),
+            ('FSTRING',           r'f"(?:\{\{|\}\}|\{[^{}]*\}|[^"{}])*"'),   # f-string, expressions in {} may contain quotes
             ('STRING',            r'"(.*?)"'),
             ('BOOLEAN',           r'\b(?:true|false)\b'),
             ('BITWISE_SHIFT',     r'<<|>>'),             # Bitwise left/right shift
@@ -32,7 +33,7 @@ class Lexer:
             ('BITWISE_XOR',       r'\^'),                
             ('ARITHMETIC',        r'[+\-*/%]'),
             ('ASSIGN',            r'='),
-            ('DELIMITER',         r'[;,\(\)\{\}\[\]\.]'),
+            ('DELIMITER',         r'[;,:\(\)\{\}\[\]\.]'),
             ('IDEN',              r'[A-Za-z_][A-Za-z0-9_]*'),
             ('NEWLINE',           r'\n'),
             ('WHITESPACE',        r'[ \t]+'),
@@ -1,4 +1,5 @@
 from custom_ast_nodes import *
+from custom_lexer import Lexer
 
 """
 Logic:
@@ -54,6 +55,8 @@ class Parser:
                     return self.parse_var_decl()
                 case "fn":
                     return self.parse_function_decl()
+                case "extern":
+                    return self.parse_extern_decl()
                 case "loop":
                     return self.parse_loop_stmt()
                 case "if":
@@ -260,7 +263,27 @@ class Parser:
             node = BinaryOp(node, op, right)
         return node
 
-    def parse_factor(self):         # Parse a factor, which can be a literal, identifier, function call, or a parenthesized expression (Most basic unit of an expression)
+    def parse_factor(self):         # Parse a factor followed by any number of index/slice suffixes e.g. s[0], s[1:3][0]
+        node = self.parse_primary()
+        while self.current_token() and self.current_token().type == "DELIMITER" and self.current_token().value == "[":
+            node = self.parse_subscript(node)
+        return node
+
+    def parse_subscript(self, target):  # Parse [index], [start:end], [start:] or [:end] after target
+        self.consume("DELIMITER", "[")
+        start = None
+        if not (self.current_token().type == "DELIMITER" and self.current_token().value == ":"):
+            start = self.parse_expression()
+            if self.match("DELIMITER", "]"):
+                return IndexExpr(target, start)
+        self.consume("DELIMITER", ":")
+        end = None
+        if not (self.current_token().type == "DELIMITER" and self.current_token().value == "]"):
+            end = self.parse_expression()
+        self.consume("DELIMITER", "]")
+        return SliceExpr(target, start, end)
+
+    def parse_primary(self):        # Parse a primary, which can be a literal, identifier, function call, or a parenthesized expression (Most basic unit of an expression)
         token = self.current_token()
         if token.type == "KEYWORD" and token.value == "NULL":    # Check for null keyword
             self.consume("KEYWORD", "NULL")
@@ -279,6 +302,9 @@ class Parser:
                 case _:
                     raise Exception(f"Unexpected token {token}")
             return Literal(value, type(value).__name__)
+        elif token.type == "FSTRING":   # Check for an f-string e.g. f"hello {name}!"
+            self.consume("FSTRING")
+            return self.parse_fstring(token.value[2:-1])
         elif token.type == "IDEN":      # Check for a function call
             self.consume("IDEN")
             if self.current_token() and self.current_token().type == "DELIMITER" and self.current_token().value == "(":
@@ -338,6 +364,35 @@ class Parser:
         else:
             raise Exception(f"Unexpected token {token}")
         
+    def parse_fstring(self, text):  # Split the body of an f-string into literal text and the expressions between {}
+        parts = []
+        literal = ""
+        i = 0
+        while i < len(text):
+            if text[i] in "{}" and text[i + 1:i + 2] == text[i]:    # {{ and }} are literal braces
+                literal += text[i]
+                i += 2
+            elif text[i] == "{":
+                end = text.index("}", i)    # the lexer guarantees a matching }
+                if literal:
+                    parts.append(Literal(literal, "str"))
+                    literal = ""
+                sub_parser = Parser(Lexer(text[i + 1:end]).tokenize())
+                if not sub_parser.tokens:
+                    raise Exception("Empty expression in f-string")
+                parts.append(sub_parser.parse_expression())
+                if sub_parser.current_token() is not None:
+                    raise Exception(f"Unexpected token {sub_parser.current_token()} in f-string")
+                i = end + 1
+            else:
+                literal += text[i]
+                i += 1
+        if literal or not parts:
+            parts.append(Literal(literal, "str"))
+        if len(parts) == 1 and isinstance(parts[0], Literal):   # no expressions, just a string
+            return parts[0]
+        return FormatExpr(parts)
+
     def peek(self):     # Peek at the next token in the list, useful for identifiers to check that the next token is ASSIGN operator
         if self.pos + 1 < len(self.tokens):
             return self.tokens[self.pos + 1]
@@ -366,6 +421,23 @@ class Parser:
         body = self.parse_block()
         return FunctionDecl(name, params, body)
     
+    def parse_extern_decl(self):     # Parse a native function declaration: extern fn name(params) from "library";
+        self.consume("KEYWORD", "extern")
+        self.consume("KEYWORD", "fn")
+        name = Identifier(self.consume("IDEN").value)
+        self.consume("DELIMITER", "(")
+        params = []
+        if not (self.current_token().type == "DELIMITER" and self.current_token().value == ")"):
+            params.append(Identifier(self.consume("IDEN").value))
+            while self.current_token() and self.current_token().type == "DELIMITER" and self.current_token().value == ",":
+                self.consume("DELIMITER", ",")
+                params.append(Identifier(self.consume("IDEN").value))
+        self.consume("DELIMITER", ")")
+        self.consume("KEYWORD", "from")
+        library = self.consume("STRING").value[1:-1]   # Remove the surrounding quotes
+        self.consume("DELIMITER", ";")
+        return ExternDecl(name, params, library)
+
     def parse_return_stmt(self):
         self.consume("KEYWORD", "return")
         expr = self.parse_expression()
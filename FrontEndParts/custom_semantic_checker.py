@@ -45,10 +45,40 @@ class SymbolTable:
         self.in_function = False
         self.exit_scope()
 
+# Builtin functions registered by the VM (vm/builtins.c): name -> number of arguments.
+# They are never pure, so functions calling them are not memoized.
+BUILTIN_FUNCTIONS = {
+    "sb_new": 0,
+    "sb_append": 2,
+    "sb_build": 1,
+    "find": 2,
+    "count": 2,
+    "split": 3,
+    "replace": 3,
+    "starts_with": 2,
+    "ends_with": 2,
+    "upper": 1,
+    "lower": 1,
+    "open": 2,
+    "readline": 1,
+    "write": 2,
+    "writeline": 2,
+    "close": 1,
+    "read_all": 1,
+    "read_async": 1,
+    "write_async": 2,
+    "sleep_async": 1,
+    "await": 1,
+}
+
 class SemanticChecker:
     def __init__(self):
         self.symbol_table = SymbolTable()
         self.current_function = None  # Track the current function being analyzed
+        self.function_locals = None   # Names that are locals of the current function (params, var declarations, loop variables)
+        self.function_effects = {}    # Mapping: function name -> {"node", "impure", "callees"} used to mark pure functions
+        for name, num_args in BUILTIN_FUNCTIONS.items():
+            self.symbol_table.define_function(name, [(f"arg{i}", None) for i in range(num_args)])
 
     def check(self, node):
         method_name = f"visit_{type(node).__name__}"
@@ -68,6 +98,7 @@ class SemanticChecker:
     def visit_Program(self, node):
         for stmt in node.statements:
             self.check(stmt)
+        self.mark_pure_functions()
     
     def visit_FunctionDecl(self, node):
         # Define the function in the current scope
@@ -82,6 +113,8 @@ class SemanticChecker:
 
         # Set the current function
         self.current_function = node.name.name
+        self.function_locals = {param.name for param in node.params}
+        self.function_effects[node.name.name] = {"node": node, "impure": False, "callees": set()}
 
         # Check the function body for unreachable code
         self.visit_Block(node.body)
@@ -91,12 +124,21 @@ class SemanticChecker:
 
         # Reset the current function
         self.current_function = None
+        self.function_locals = None
 
         # Exit function scope
         self.symbol_table.exit_function_scope()
 
+    def visit_ExternDecl(self, node):
+        if self.current_function:
+            raise Exception(f"Semantic Error: extern function '{node.name.name}' must be declared at top level")
+        # Native functions are never pure as the checker cannot see their bodies (they are not in function_effects)
+        self.symbol_table.define_function(node.name.name, [(param.name, None) for param in node.params])
+
     def visit_VarDecl(self, node):
         value_type = self.check(node.expr)
+        if self.current_function:
+            self.function_locals.add(node.identifier.name)
         try:
             existing_type = self.symbol_table.lookup(node.identifier.name)
             if existing_type != value_type:
@@ -108,6 +150,8 @@ class SemanticChecker:
             self.symbol_table.define(node.identifier.name, value_type)
 
     def visit_Assignment(self, node):
+        if isinstance(node.left, (IndexExpr, SliceExpr)):
+            raise Exception("Semantic Error: Strings are immutable, cannot assign to an index or slice")
         try:
             var_type = self.symbol_table.lookup(node.left.name)
         except Exception:
@@ -116,6 +160,9 @@ class SemanticChecker:
         # Check if the variable is a control variable
         if self.symbol_table.is_control_var(node.left.name):
             raise Exception(f"Semantic Error: Cannot modify control variable '{node.left.name}'")
+
+        if self.current_function and node.left.name not in self.function_locals:
+            self.mark_impure()  # writes a global
     
         value_type = self.check(node.right)
         self.symbol_table.define(node.left.name, value_type)
@@ -174,8 +221,27 @@ class SemanticChecker:
         #         raise Exception(f"Unary Error: Cannot apply '-' to type '{operand_type}'")
 
     def visit_Identifier(self, node):
+        if self.current_function and node.name not in self.function_locals:
+            self.mark_impure()  # reads a global, which may change between calls
         return self.symbol_table.lookup(node.name)
 
+    def visit_IndexExpr(self, node):
+        self.check(node.target)
+        self.check(node.index)
+        return "string"
+
+    def visit_SliceExpr(self, node):
+        self.check(node.target)
+        for bound in (node.start, node.end):
+            if bound is not None:
+                self.check(bound)
+        return "string"
+
+    def visit_FormatExpr(self, node):
+        for part in node.parts:
+            self.check(part)
+        return "string"
+
     def visit_IfStmt(self, node):
         # Skipping condition type checking
         self.check(node.condition)
@@ -209,6 +275,8 @@ class SemanticChecker:
         
         # Define the loop control variable and mark it as a control variable
         self.symbol_table.define(node.var.name, "int", is_control_var=True)
+        if self.current_function:
+            self.function_locals.add(node.var.name)
         
         # Check the loop body
         self.check(node.body)
@@ -218,6 +286,14 @@ class SemanticChecker:
 
     def visit_ReturnStmt(self, node):
         return self.check(node.expr)
+
+    def visit_PrintStmt(self, node):
+        self.mark_impure()
+        self.generic_visit(node)
+
+    def visit_InputStmt(self, node):
+        self.mark_impure()
+        self.generic_visit(node)
     
     def visit_Block(self, node):
         self.symbol_table.enter_scope()
@@ -249,6 +325,9 @@ class SemanticChecker:
         for arg in node.arguments:
             self.check(arg)  # just validate the argument, not comparing its type.
 
+        if self.current_function:
+            self.function_effects[self.current_function]["callees"].add(node.callee.name)
+
 # ================================================ extra functions ================================================
     # def check_for_infinite_recursion(self, node):
     #     if isinstance(node, Block):
@@ -267,6 +346,27 @@ class SemanticChecker:
     #                     if isinstance(item, ASTNode):
     #                         self.check_for_infinite_recursion(item)
 
+    def mark_impure(self):
+        if self.current_function:
+            self.function_effects[self.current_function]["impure"] = True
+
+    def mark_pure_functions(self):
+        """
+        A function is pure when it does not touch globals, does not print or read input and only calls pure functions.
+        Pure functions get node.is_pure = True, which the bytecode generator writes into the function header so the
+        VM can memoize their results.
+        """
+        pure = {name for name, effects in self.function_effects.items() if not effects["impure"]}
+        changed = True
+        while changed:  # drop functions with impure callees until nothing changes (recursive calls are fine)
+            changed = False
+            for name in list(pure):
+                if not self.function_effects[name]["callees"] <= pure:
+                    pure.discard(name)
+                    changed = True
+        for name, effects in self.function_effects.items():
+            effects["node"].is_pure = name in pure
+
     def collect_declared_vars(self, block):
         declared = set()
         if isinstance(block, Block):
@@ -47,8 +47,8 @@ def semantic_analysis(ast):
         print(f"Semantic Analysis: FAIL ({e})")
         return False
 
-def generate_bytecode(ast, output_file):
-    generator = BytecodeGenerator()
+def generate_bytecode(ast, output_file, inline_size=64, inline_depth=2):
+    generator = BytecodeGenerator(inline_max_size=inline_size, inline_max_depth=inline_depth)
     generator.write_bytecode(ast, output_file)
     # generator.write_textfile(ast, output_file)
 
@@ -57,6 +57,8 @@ def main():
     parser_arg = argparse.ArgumentParser(description="Custom Language Compiler")
     parser_arg.add_argument("-i", "--input", required=True, help="Input source code file (.rtsk)")
     # parser_arg.add_argument("-o", "--output", required=True, help="Output bytecode file")
+    parser_arg.add_argument("--inline-size", type=int, default=64, help="Largest function body (in bytes) that is inlined at call sites, 0 disables inlining")
+    parser_arg.add_argument("--inline-depth", type=int, default=2, help="Maximum nesting of inlined calls")
     args = parser_arg.parse_args()
 
     inputfileName = args.input.split('\\')[-1].split('.')[0]  # get the file name without extension
@@ -74,7 +76,7 @@ def main():
 
     if not semantic_analysis(ast): return# Semantic analysis
 
-    generate_bytecode(ast, output_file) # Bytecode generation
+    generate_bytecode(ast, output_file, args.inline_size, args.inline_depth) # Bytecode generation
 
     # readBytecodeFile(output_file) # Read the generated bytecode file (For testing purposes)
     
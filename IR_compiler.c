@@ -41,6 +41,7 @@ void write_uint8(FILE *f, uint8_t val) { fwrite(&val, 1, 1, f); }
 void write_uint16(FILE *f, uint16_t val) { fwrite(&val, 2, 1, f); }
 void write_int32(FILE *f, int32_t val) { fwrite(&val, 4, 1, f); }
 void write_int64(FILE *f, int64_t val) { fwrite(&val, 8, 1, f); }
+void write_uint64(FILE *f, uint64_t val) { fwrite(&val, 8, 1, f); }
 void write_double(FILE *f, double val) { fwrite(&val, 8, 1, f); }
 
 int map_opcode(const char *token) {
@@ -85,6 +86,9 @@ int map_opcode(const char *token) {
     if (strcmp(token, "OP_PARSEBOOL") == 0) return OP_PARSEBOOL;
     if (strcmp(token, "OP_PARSESTR") == 0) return OP_PARSESTR;
     if (strcmp(token, "OP_PARSEFLOAT") == 0) return OP_PARSEFLOAT;
+    if (strcmp(token, "OP_EXTERN") == 0) return OP_EXTERN;
+    if (strcmp(token, "OP_INDEX") == 0) return OP_INDEX;
+    if (strcmp(token, "OP_SLICE") == 0) return OP_SLICE;
     return -1;
 }
 
@@ -105,10 +109,347 @@ int map_opcode(const char *token) {
 //     }
 // }
 
+/* Directory entries are sorted by the names they point at in the compiled image */
+static const uint8_t *sort_image;
+
+static int compare_directory_entries(const void *a, const void *b) {
+    const FunctionDirEntry *x = a;
+    const FunctionDirEntry *y = b;
+    const uint8_t *y_name = sort_image + y->name_offset;
+    int order = id_compare(sort_image + x->name_offset, id_name(y_name), id_length(y_name));
+    if (order == 0) { // keep definitions in file order, the last one wins
+        order = (x->body_offset > y->body_offset) - (x->body_offset < y->body_offset);
+    }
+    return order;
+}
+
+/* ///////////////////////// ENCODING ///////////////////////// */
+
+static uint64_t zigzag(int64_t value) { return ((uint64_t)value << 1) ^ (uint64_t)(value >> 63); }
+
+static size_t uleb_size(uint64_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        size++;
+    }
+    return size;
+}
+
+// Writes value in exactly width bytes (width >= uleb_size(value), extra bytes are continuation padding)
+static uint8_t *put_uleb(uint8_t *p, uint64_t value, size_t width) {
+    for (size_t i = 1; i < width; i++) {
+        *p++ = (uint8_t)(value & 0x7f) | 0x80;
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+// Operand of the standard encoding: int64, int32 (jump offsets) or uint16 (local indices, counts)
+static int64_t read_int(const uint8_t *p, size_t size) {
+    int64_t value64;
+    int32_t value32;
+    uint16_t value16;
+    switch (size) {
+        case 8: memcpy(&value64, p, 8); return value64;
+        case 4: memcpy(&value32, p, 4); return value32;
+        default: memcpy(&value16, p, 2); return value16;
+    }
+}
+
+// Operand bytes after the opcode in the standard encoding, -1 for bytes that are not an opcode
+static long wide_operand_size(const uint8_t *p) {
+    switch (*p) {
+        case INT: case FLOAT: return 8;
+        case BOOL: return 1;
+        case STR: {
+            uint32_t length;
+            memcpy(&length, p + 1, 4);
+            return 4 + (long)length;
+        }
+        case ID: return 2 + 8 + id_length(p + 1);
+        case LOCAL: case OP_FORMAT: return 2;
+        case OP_JMP: case OP_JMPIF: return 4;
+        case OP_FUNCDEF: return 3 * sizeof(uint16_t); // NUMARGS, NUMVARS, FUNCFLAGS
+        default: return *p <= OP_FORMAT ? 0 : -1;
+    }
+}
+
+// Size of an instruction in the compact encoding (jumps and constants are sized by the caller)
+static size_t compact_size(const uint8_t *p) {
+    switch (*p) {
+        case INT: {
+            int64_t value = read_int(p + 1, 8);
+            return value >= INT8_MIN && value <= INT8_MAX ? 2 : 1 + uleb_size(zigzag(value));
+        }
+        case LOCAL: {
+            uint64_t index = (uint64_t)read_int(p + 1, 2);
+            return index <= 7 ? 1 : 1 + uleb_size(index);
+        }
+        case OP_FORMAT:
+            return 1 + uleb_size((uint64_t)read_int(p + 1, 2));
+        default:
+            return 1 + (size_t)wide_operand_size(p);
+    }
+}
+
+// Index of the instruction starting at offset (count for the end of the code), -1 if no instruction starts there
+static long find_instruction(const size_t *starts, size_t count, size_t offset) {
+    size_t low = 0;
+    size_t high = count + 1; // starts[count] is the end of the code
+    while (low < high) {
+        size_t mid = low + (high - low) / 2;
+        if (starts[mid] == offset) return (long)mid;
+        if (starts[mid] < offset) low = mid + 1;
+        else high = mid;
+    }
+    return -1;
+}
+
+/*
+Constant pool: the literals the code pushes with OP_CONST. Each entry is the literal's standard encoding instruction
+(INT, FLOAT or STR with its operand) and equal literals share one entry.
+*/
+typedef struct {
+    uint8_t *bytes;
+    size_t length;
+    size_t capacity;
+    size_t count;
+    Hashmap *entries; // entry bytes -> index + 1
+} ConstantPool;
+
+static int is_pooled(const uint8_t *p) {
+    if (*p == INT) { // small ints are preloaded by the vm, pushing them never allocates
+        int64_t value = read_int(p + 1, 8);
+        return value < -SMALL_INT_MAX || value > SMALL_INT_MAX;
+    }
+    return *p == FLOAT || *p == STR;
+}
+
+// Index of the entry equal to the literal instruction p, -1 if out of memory
+static long pool_add(ConstantPool *pool, const uint8_t *p) {
+    size_t length = 1 + (size_t)wide_operand_size(p);
+    uint64_t h = hashmap_hash((const char *)p, length);
+    uintptr_t found = (uintptr_t)hashmap_get_prehashed(pool->entries, (const char *)p, length, h);
+    if (found) {
+        return (long)(found - 1);
+    }
+    if (pool->length + length > pool->capacity) {
+        size_t capacity = pool->capacity ? pool->capacity : 4096;
+        while (pool->length + length > capacity) {
+            capacity *= 2;
+        }
+        uint8_t *grown = realloc(pool->bytes, capacity);
+        if (!grown) {
+            return -1;
+        }
+        pool->bytes = grown;
+        pool->capacity = capacity;
+    }
+    memcpy(pool->bytes + pool->length, p, length);
+    pool->length += length;
+    hashmap_set_prehashed(pool->entries, (const char *)p, length, h, (void *)(uintptr_t)(pool->count + 1), NULL);
+    return (long)pool->count++;
+}
+
+/*
+Rewrites the code compile_ir streamed out (code_size bytes starting at file offset sizeof(BytecodeHeader)):
+INT (outside the small int range), FLOAT and STR become OP_CONST with their literal moved to the constant pool, and
+with BYTECODE_FLAG_COMPACT the compact encoding is used. The frontend measures jump offsets in the standard encoding,
+so every jump is resolved to the instruction it lands on and given a new offset. Compact jumps start out short and
+only grow until all of them fit, which always ends.
+The function directory and the func section bounds are moved to the new offsets.
+Returns the new code (malloc'd, *code_size is updated) or NULL after printing an error.
+*/
+static uint8_t *encode_code(const uint8_t *code, size_t *code_size, uint32_t flags, ConstantPool *pool,
+                            FunctionDirEntry *directory, size_t function_count, int64_t *func_start,
+                            int64_t *func_end) {
+    const size_t base = sizeof(BytecodeHeader);
+    const uint8_t *image = code - base; // file offsets index image
+    const int compact = (flags & BYTECODE_FLAG_COMPACT) != 0;
+    size_t capacity = 1024;
+    size_t count = 0;
+    size_t *starts = malloc(capacity * sizeof(size_t));
+    for (size_t offset = base; starts && offset < base + *code_size;) {
+        long operands = wide_operand_size(image + offset);
+        if (operands < 0) {
+            fprintf(stderr, "Cannot encode unknown opcode %u at offset %zu\n", image[offset], offset);
+            free(starts);
+            return NULL;
+        }
+        if (count + 1 == capacity) {
+            capacity *= 2;
+            size_t *grown = realloc(starts, capacity * sizeof(size_t));
+            if (!grown) {
+                free(starts);
+                starts = NULL;
+                break;
+            }
+            starts = grown;
+        }
+        starts[count++] = offset;
+        offset += 1 + (size_t)operands;
+    }
+    size_t *operands = starts ? malloc((count + 1) * sizeof(size_t)) : NULL; // jump target or constant index
+    size_t *sizes = operands ? malloc((count + 1) * sizeof(size_t)) : NULL;
+    size_t *moved = sizes ? malloc((count + 1) * sizeof(size_t)) : NULL; // new file offset of every instruction
+    if (!moved) {
+        fprintf(stderr, "Out of memory while encoding bytecode\n");
+        free(starts);
+        free(operands);
+        free(sizes);
+        return NULL;
+    }
+    starts[count] = base + *code_size;
+
+    int failed = 0;
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t *p = image + starts[i];
+        if (*p == OP_JMP || *p == OP_JMPIF) {
+            long target = find_instruction(starts, count, starts[i + 1] + (size_t)read_int(p + 1, 4));
+            if (target < 0) {
+                fprintf(stderr, "Jump at offset %zu does not land on an instruction\n", starts[i]);
+                failed = 1;
+                break;
+            }
+            operands[i] = (size_t)target;
+            sizes[i] = compact ? 2 : 1 + 4;
+        } else if (is_pooled(p)) {
+            long index = pool_add(pool, p);
+            if (index < 0) {
+                fprintf(stderr, "Out of memory for the constant pool\n");
+                failed = 1;
+                break;
+            }
+            operands[i] = (size_t)index;
+            sizes[i] = 1 + (compact ? uleb_size((uint64_t)index) : sizeof(uint32_t));
+        } else {
+            sizes[i] = compact ? compact_size(p) : 1 + (size_t)wide_operand_size(p);
+        }
+    }
+    if (failed) {
+        free(starts);
+        free(operands);
+        free(sizes);
+        free(moved);
+        return NULL;
+    }
+
+    int changed = 1;
+    while (changed) {
+        changed = 0;
+        moved[0] = base;
+        for (size_t i = 0; i < count; i++) {
+            moved[i + 1] = moved[i] + sizes[i];
+        }
+        for (size_t i = 0; compact && i < count; i++) {
+            uint8_t op = image[starts[i]];
+            if (op != OP_JMP && op != OP_JMPIF) continue;
+            int64_t offset = (int64_t)moved[operands[i]] - (int64_t)moved[i + 1];
+            size_t needed = offset >= INT8_MIN && offset <= INT8_MAX ? 2 : 1 + uleb_size(zigzag(offset));
+            if (needed > sizes[i]) {
+                sizes[i] = needed;
+                changed = 1;
+            }
+        }
+    }
+
+    uint8_t *encoded = malloc(moved[count] - base ? moved[count] - base : 1);
+    uint8_t *out = encoded;
+    for (size_t i = 0; encoded && i < count; i++) {
+        const uint8_t *p = image + starts[i];
+        if (is_pooled(p)) {
+            *out++ = OP_CONST;
+            if (compact) {
+                out = put_uleb(out, operands[i], sizes[i] - 1);
+            } else {
+                uint32_t index = (uint32_t)operands[i];
+                memcpy(out, &index, sizeof(uint32_t));
+                out += sizeof(uint32_t);
+            }
+            continue;
+        }
+        if (!compact && *p != OP_JMP && *p != OP_JMPIF) {
+            memcpy(out, p, sizes[i]);
+            out += sizes[i];
+            continue;
+        }
+        switch (*p) {
+            case INT: {
+                int64_t value = read_int(p + 1, 8);
+                if (sizes[i] == 2) {
+                    *out++ = INT8;
+                    *out++ = (uint8_t)(int8_t)value;
+                } else {
+                    *out++ = INT;
+                    out = put_uleb(out, zigzag(value), sizes[i] - 1);
+                }
+                break;
+            }
+            case LOCAL: {
+                uint64_t index = (uint64_t)read_int(p + 1, 2);
+                if (sizes[i] == 1) {
+                    *out++ = (uint8_t)(LOCAL_0 + index);
+                } else {
+                    *out++ = LOCAL;
+                    out = put_uleb(out, index, sizes[i] - 1);
+                }
+                break;
+            }
+            case OP_FORMAT:
+                *out++ = OP_FORMAT;
+                out = put_uleb(out, (uint64_t)read_int(p + 1, 2), sizes[i] - 1);
+                break;
+            case OP_JMP:
+            case OP_JMPIF: {
+                int64_t offset = (int64_t)moved[operands[i]] - (int64_t)moved[i + 1];
+                if (!compact) {
+                    int32_t wide = (int32_t)offset;
+                    *out++ = *p;
+                    memcpy(out, &wide, sizeof(int32_t));
+                    out += sizeof(int32_t);
+                } else if (sizes[i] == 2 && offset >= INT8_MIN && offset <= INT8_MAX) {
+                    *out++ = *p == OP_JMP ? OP_JMP_SHORT : OP_JMPIF_SHORT;
+                    *out++ = (uint8_t)(int8_t)offset;
+                } else {
+                    *out++ = *p;
+                    out = put_uleb(out, zigzag(offset), sizes[i] - 1); // a jump that grew keeps its size
+                }
+                break;
+            }
+            default:
+                memcpy(out, p, sizes[i]);
+                out += sizes[i];
+                break;
+        }
+    }
+
+    if (encoded) {
+        for (size_t i = 0; i < function_count; i++) {
+            FunctionDirEntry *entry = &directory[i];
+            size_t body_end = moved[find_instruction(starts, count, entry->body_offset + entry->body_length)];
+            entry->name_offset = (uint32_t)moved[find_instruction(starts, count, entry->name_offset - 1)] + 1;
+            entry->body_offset = (uint32_t)moved[find_instruction(starts, count, entry->body_offset)];
+            entry->body_length = (uint32_t)(body_end - entry->body_offset);
+        }
+        if (*func_start) *func_start = (int64_t)moved[find_instruction(starts, count, (size_t)*func_start)];
+        if (*func_end) *func_end = (int64_t)moved[find_instruction(starts, count, (size_t)*func_end)];
+        *code_size = moved[count] - base;
+    } else {
+        fprintf(stderr, "Out of memory while encoding bytecode\n");
+    }
+    free(starts);
+    free(operands);
+    free(sizes);
+    free(moved);
+    return encoded;
+}
+
 #define GREEN "\033[0;32m"
 #define WHITE "\033[0m"
 
-int compile_ir(const char *input_path, const char *output_path) {
+int compile_ir(const char *input_path, const char *output_path, uint32_t flags) {
     FILE *in = fopen(input_path, "rb");
     if (!in) {
         perror("Failed to open input");
@@ -135,6 +476,12 @@ int compile_ir(const char *input_path, const char *output_path) {
     int64_t func_start = 0;
     int64_t func_end = 0;
 
+    // Function directory, filled in as OP_FUNCDEF headers are compiled
+    FunctionDirEntry *directory = NULL;
+    size_t function_count = 0;
+    size_t directory_capacity = 0;
+    int in_func_header = 0; // between OP_FUNCDEF and the function's name
+
     char *line = NULL;
     size_t len = 0;
     ssize_t read;
@@ -183,17 +530,33 @@ int compile_ir(const char *input_path, const char *output_path) {
                 uint16_t len16 = atoi(len_str);
                 if (strcmp(token, "STR") == 0) {
                     write_uint8(out, STR);              byte_offset += 1;
-                    uint32_t len32 = len16;
+                    uint32_t len32 = (uint32_t)strtoul(len_str, NULL, 10); // literals may exceed 64 KiB
                     fwrite(&len32, sizeof(uint32_t), 1, out); byte_offset += 4;
-                    fwrite(val, sizeof(char), len16, out);   byte_offset += len16;
+                    if (len32) fwrite(val, sizeof(char), len32, out); // val is NULL for ""
+                    byte_offset += len32;
 
                 } else {
+                    if (in_func_header) {
+                        directory[function_count - 1].name_offset = (uint32_t)(byte_offset + 1);
+                    }
+                    // the name's hash is computed once here so the VM never hashes identifiers at runtime
                     write_uint8(out, ID);               byte_offset += 1;
                     fwrite(&len16, sizeof(uint16_t), 1, out); byte_offset += 2;
+                    write_uint64(out, hashmap_hash(val, len16)); byte_offset += 8;
                     fwrite(val, sizeof(char), len16, out);   byte_offset += len16;
+                    if (in_func_header) {
+                        directory[function_count - 1].body_offset = (uint32_t)byte_offset;
+                        in_func_header = 0;
+                    }
 
                 }
             }
+        } else if (strcmp(token, "OP_FORMAT") == 0) {
+            char *arg = strtok(NULL, " \t\r\n");
+            uint16_t count = atoi(arg);
+            write_uint8(out, OP_FORMAT); byte_offset += 1;
+            write_uint16(out, count);    byte_offset += 2;
+
         } else if (strcmp(token, "LOCAL") == 0) {
             char *arg = strtok(NULL, " \t\r\n");
             uint16_t idx = atoi(arg);
@@ -209,25 +572,49 @@ int compile_ir(const char *input_path, const char *output_path) {
             write_uint8(out, strcmp(token, "OP_JMP") == 0 ? OP_JMP : OP_JMPIF); byte_offset += 1;
             write_int32(out, offset); byte_offset += 4;
 
-        } else if (strcmp(token, "NUMARGS") == 0 || strcmp(token, "NUMVARS") == 0) {
+        } else if (strcmp(token, "NUMARGS") == 0 || strcmp(token, "NUMVARS") == 0 || strcmp(token, "FUNCFLAGS") == 0) {
             char *arg = strtok(NULL, " \t\r\n");
             uint16_t count = atoi(arg);
             // printf("  %s count: %d\n", token, count);
             write_uint16(out, count); byte_offset += 2;
+            if (in_func_header) {
+                FunctionDirEntry *entry = &directory[function_count - 1];
+                if (strcmp(token, "NUMARGS") == 0) entry->num_args = count;
+                else if (strcmp(token, "NUMVARS") == 0) entry->num_vars = count;
+                else entry->flags = count;
+            }
             
         } else {
             int op = map_opcode(token);
             if (op != -1) {
-                if (strcmp(token, "OP_FUNCDEF") == 0 && func_start == 0) {
-                    func_start = byte_offset;
+                if (strcmp(token, "OP_FUNCDEF") == 0) {
+                    if (func_start == 0) {
+                        func_start = byte_offset;
+                    }
+                    if (function_count == directory_capacity) {
+                        directory_capacity = directory_capacity ? directory_capacity * 2 : 64;
+                        FunctionDirEntry *grown = realloc(directory, directory_capacity * sizeof(FunctionDirEntry));
+                        if (!grown) {
+                            fprintf(stderr, "Out of memory for the function directory\n");
+                            exit(EXIT_FAILURE);
+                        }
+                        directory = grown;
+                    }
+                    memset(&directory[function_count++], 0, sizeof(FunctionDirEntry));
+                    in_func_header = 1;
                 }
                 if (strcmp(token, "OP_ENDFUNC") == 0) {
                     func_end = byte_offset+1;
+                    if (function_count > 0) {
+                        FunctionDirEntry *entry = &directory[function_count - 1];
+                        entry->body_length = (uint32_t)(func_end - entry->body_offset);
+                    }
                 }
                 // printf("  Writing opcode: %s (%d)\n", token, op);
                 write_uint8(out, op); byte_offset += 1;
             } else {
                 fprintf(stderr, "Unknown token on line %d: %s\n", lineno, token);
+                free(directory);
                 free(line);
                 fclose(in);
                 fclose(out);
@@ -246,14 +633,101 @@ int compile_ir(const char *input_path, const char *output_path) {
     fflush(out);
 
     // Set header values
-    hdr.func_section_start = (uint32_t)func_start;
-    hdr.func_section_end = (uint32_t)func_end;
     hdr.class_section_start = 0;
     hdr.class_section_end = 0;
+    hdr.hash_check = hashmap_hash(HASH_CHECK_KEY, strlen(HASH_CHECK_KEY));
+    hdr.version = BYTECODE_VERSION;
+    hdr.flags = flags;
+
+    // Read the code back: it is re-encoded with its literals moved to the constant pool, the directory is sorted by
+    // the names in it and the checksum covers all of it
+    fseek(out, 0, SEEK_END);
+    size_t code_size = (size_t)ftell(out) - sizeof(BytecodeHeader);
+    uint8_t *code = malloc(code_size ? code_size : 1);
+    if (!code || fseek(out, sizeof(BytecodeHeader), SEEK_SET) != 0 || fread(code, 1, code_size, out) != code_size) {
+        fprintf(stderr, "Failed to read back output\n");
+        free(code);
+        free(directory);
+        fclose(out);
+        return 1;
+    }
+    ConstantPool pool = {NULL, 0, 0, 0, init_hashmap(MAX_CONSTANTS)};
+    uint8_t *encoded = pool.entries ? encode_code(code, &code_size, flags, &pool, directory, function_count,
+                                                  &func_start, &func_end) : NULL;
+    free(code);
+    if (pool.entries) {
+        free_hashmap(pool.entries, NULL);
+    }
+    if (!encoded) {
+        free(pool.bytes);
+        free(directory);
+        fclose(out);
+        return 1;
+    }
+    code = encoded;
+    hdr.func_section_start = (uint32_t)func_start;
+    hdr.func_section_end = (uint32_t)func_end;
 
-    // Patch the header at the beginning
-    fseek(out, 0, SEEK_SET);
-    fwrite(&hdr, sizeof(hdr), 1, out);
+    // Sort the function directory by name and keep only the last definition of each name
+    sort_image = code - sizeof(BytecodeHeader);
+    if (function_count > 0) {
+        qsort(directory, function_count, sizeof(FunctionDirEntry), compare_directory_entries);
+    }
+    size_t unique = 0;
+    for (size_t i = 0; i < function_count; i++) {
+        const uint8_t *name = sort_image + directory[i].name_offset;
+        if (unique > 0 && id_compare(sort_image + directory[unique - 1].name_offset, id_name(name), id_length(name)) == 0) {
+            unique--; // redefined later in the file
+        }
+        directory[unique++] = directory[i];
+    }
+
+    // Body: the code, padding up to 8 byte alignment, the directory and the constant pool
+    size_t padding = (sizeof(uint64_t) - (sizeof(BytecodeHeader) + code_size) % sizeof(uint64_t)) % sizeof(uint64_t);
+    size_t directory_size = unique * sizeof(FunctionDirEntry);
+    size_t body_size = code_size + padding + directory_size + pool.length;
+    if (sizeof(BytecodeHeader) + body_size > UINT32_MAX) {
+        fprintf(stderr, "Bytecode too large: %zu bytes, offsets are 32 bit\n", sizeof(BytecodeHeader) + body_size);
+        free(code);
+        free(directory);
+        free(pool.bytes);
+        fclose(out);
+        return 1;
+    }
+    uint8_t *body = calloc(body_size ? body_size : 1, 1);
+    if (!body) {
+        fprintf(stderr, "Failed to allocate output\n");
+        free(code);
+        free(directory);
+        free(pool.bytes);
+        fclose(out);
+        return 1;
+    }
+    memcpy(body, code, code_size);
+    if (unique > 0) {
+        memcpy(body + code_size + padding, directory, directory_size);
+    }
+    if (pool.length > 0) {
+        memcpy(body + code_size + padding + directory_size, pool.bytes, pool.length);
+    }
+    free(code);
+    free(directory);
+    free(pool.bytes);
+    hdr.directory_start = (uint32_t)(sizeof(BytecodeHeader) + code_size + padding);
+    hdr.function_count = (uint32_t)unique;
+    hdr.pool_start = (uint32_t)(hdr.directory_start + directory_size);
+    hdr.pool_count = (uint32_t)pool.count;
+    hdr.checksum = bytecode_checksum(body, body_size);
+
+    // Write the final file (the encoded code is shorter than what was streamed out)
+    out = freopen(output_path, "wb", out);
+    if (!out || fwrite(&hdr, sizeof(hdr), 1, out) != 1 || fwrite(body, 1, body_size, out) != body_size) {
+        perror("Failed to write output");
+        free(body);
+        if (out) fclose(out);
+        return 1;
+    }
+    free(body);
     fclose(out);
 
     // printf(GREEN "Patched header written:\n" WHITE);
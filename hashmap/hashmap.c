@@ -2,97 +2,416 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
-/* ///////////////////////// HASHMAP ///////////////////////// */
-Hashmap * init_hashmap(size_t capacity) {
-    Hashmap * hashmap = malloc(sizeof(Hashmap));
-    if (! hashmap) { // ensure that we can allocate space for the hashmap
-        printf("Hashmap allocation failed\n");
-        return NULL;
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define HASHMAP_SSE2
+#include <emmintrin.h>
+#endif
+
+#define CTRL_EMPTY   ((int8_t)-128) // 0b10000000
+#define CTRL_DELETED ((int8_t)-2)   // 0b11111110
+#define MAX_LOAD_NUM 7              // resize once (length + deleted) exceeds 7/8 of the capacity
+#define MAX_LOAD_DEN 8
+
+/* ///////////////////////// CONTROL GROUPS ///////////////////////// */
+/* Each function returns a bitmask with bit i set when control byte i of the group matches */
+
+static inline uint32_t group_match(const int8_t *group, int8_t h2) {
+#ifdef HASHMAP_SSE2
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(h2)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HASHMAP_GROUP_WIDTH; i++) {
+        mask |= (uint32_t)(group[i] == h2) << i;
     }
-    hashmap->table = calloc(capacity, sizeof(HashmapEntry*)); // allocate the size of the hashmap pointer (we use calloc here because we do not want random junk in the pointer table)
-    hashmap->length = 0;
-    hashmap->capacity = capacity;
-    return hashmap;
+    return mask;
+#endif
+}
+
+static inline uint32_t group_match_empty(const int8_t *group) {
+    return group_match(group, CTRL_EMPTY);
+}
+
+static inline uint32_t group_match_empty_or_deleted(const int8_t *group) {
+#ifdef HASHMAP_SSE2
+    // EMPTY and DELETED are the only control bytes below -1 (occupied slots hold 0..127)
+    __m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpgt_epi8(_mm_set1_epi8(-1), ctrl));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < HASHMAP_GROUP_WIDTH; i++) {
+        mask |= (uint32_t)(group[i] < -1) << i;
+    }
+    return mask;
+#endif
+}
+
+/* ///////////////////////// HELPERS ///////////////////////// */
+
+static inline int8_t hash_h2(uint64_t h) { return (int8_t)(h & 0x7F); } // stored in the control byte
+static inline size_t hash_h1(uint64_t h) { return (size_t)(h >> 7); }   // selects the first group probed
+
+static inline const char *entry_key(const HashmapEntry *entry) {
+    return entry->key_length < HASHMAP_INLINE_KEY ? entry->key.inline_key : entry->key.heap_key;
+}
+
+static inline void free_entry_key(HashmapEntry *entry) {
+    if (entry->key_length >= HASHMAP_INLINE_KEY) {
+        free(entry->key.heap_key);
+    }
+}
+
+/* Sets a control byte, keeping the mirrored copy of the first group in sync */
+static inline void set_ctrl(int8_t *ctrl, size_t capacity, size_t index, int8_t value) {
+    ctrl[index] = value;
+    if (index < HASHMAP_GROUP_WIDTH) {
+        ctrl[capacity + index] = value;
+    }
+}
+
+static size_t round_capacity(size_t capacity) {
+    size_t rounded = HASHMAP_GROUP_WIDTH;
+    while (rounded < capacity) {
+        rounded <<= 1;
+    }
+    return rounded;
+}
+
+/* ///////////////////////// HASH FUNCTION ///////////////////////// */
+/*
+SipHash-1-3 keyed with a 128 bit key. Without the key an attacker (or an unlucky code generator) can not
+produce identifiers that share a hash, so probe sequences stay short no matter which names a script uses.
+The key must be chosen before any hashmap is filled (see hashmap_random_seed / hashmap_set_seed).
+*/
+static uint64_t hash_k0 = 0x736f6d6570736575ULL; // used until a seed is chosen
+static uint64_t hash_k1 = 0x646f72616e646f6dULL;
+
+static uint64_t splitmix64(uint64_t *state) {
+    uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void hashmap_set_seed(uint64_t seed) {
+    hash_k0 = splitmix64(&seed);
+    hash_k1 = splitmix64(&seed);
+}
+
+void hashmap_random_seed(void) {
+#ifdef HASHMAP_SEED
+    hashmap_set_seed((uint64_t)(HASHMAP_SEED));
+#else
+    uint64_t seed[2] = {0, 0};
+    FILE *urandom = fopen("/dev/urandom", "rb");
+    if (!urandom || fread(seed, sizeof(seed), 1, urandom) != 1) {
+        // no /dev/urandom (e.g. windows): mix the clock with a stack address (randomised by ASLR)
+        seed[0] = (uint64_t)time(NULL) ^ ((uint64_t)clock() << 32);
+        seed[1] = (uint64_t)(uintptr_t)&seed;
+    }
+    if (urandom) {
+        fclose(urandom);
+    }
+    hash_k0 = splitmix64(&seed[0]);
+    hash_k1 = splitmix64(&seed[1]);
+#endif
+}
+
+#define ROTL64(x, b) (((x) << (b)) | ((x) >> (64 - (b))))
+#define SIPROUND                                                  \
+    do {                                                          \
+        v0 += v1; v1 = ROTL64(v1, 13); v1 ^= v0; v0 = ROTL64(v0, 32); \
+        v2 += v3; v3 = ROTL64(v3, 16); v3 ^= v2;                  \
+        v0 += v3; v3 = ROTL64(v3, 21); v3 ^= v0;                  \
+        v2 += v1; v1 = ROTL64(v1, 17); v1 ^= v2; v2 = ROTL64(v2, 32); \
+    } while (0)
+
+uint64_t hashmap_hash(const char *key, size_t length) {
+    uint64_t v0 = hash_k0 ^ 0x736f6d6570736575ULL;
+    uint64_t v1 = hash_k1 ^ 0x646f72616e646f6dULL;
+    uint64_t v2 = hash_k0 ^ 0x6c7967656e657261ULL;
+    uint64_t v3 = hash_k1 ^ 0x7465646279746573ULL;
+    const uint8_t *in = (const uint8_t *)key;
+    const uint8_t *end = in + (length & ~(size_t)7);
+    uint64_t m;
+
+    for (; in != end; in += 8) { // one compression round per 8 byte word
+        memcpy(&m, in, sizeof(m));
+        v3 ^= m;
+        SIPROUND;
+        v0 ^= m;
+    }
+
+    // last word: remaining bytes with the length in the top byte
+    m = (uint64_t)length << 56;
+    switch (length & 7) {
+        case 7: m |= (uint64_t)in[6] << 48; /* fall through */
+        case 6: m |= (uint64_t)in[5] << 40; /* fall through */
+        case 5: m |= (uint64_t)in[4] << 32; /* fall through */
+        case 4: m |= (uint64_t)in[3] << 24; /* fall through */
+        case 3: m |= (uint64_t)in[2] << 16; /* fall through */
+        case 2: m |= (uint64_t)in[1] << 8;  /* fall through */
+        case 1: m |= (uint64_t)in[0];       break;
+        case 0: break;
+    }
+    v3 ^= m;
+    SIPROUND;
+    v0 ^= m;
+
+    v2 ^= 0xff; // three finalisation rounds
+    SIPROUND;
+    SIPROUND;
+    SIPROUND;
+    return v0 ^ v1 ^ v2 ^ v3;
 }
 
 size_t hash(const char* str, size_t capacity) {
-    size_t hash = 4123;
-    while (*str) {
-        hash = ((hash << 5) + hash) + (*str++);
+    return (size_t)(hashmap_hash(str, strlen(str)) % capacity);
+}
+
+/* Returns the slot of the table (ctrl, entries, capacity) holding key or capacity if it is not in the table */
+static size_t find_slot(const int8_t *ctrl, const HashmapEntry *entries, size_t capacity,
+                        const char *key, size_t length, uint64_t h) {
+    size_t mask = capacity - 1;
+    size_t pos = hash_h1(h) & mask;
+    size_t stride = 0;
+    int8_t h2 = hash_h2(h);
+
+    while (1) {
+        const int8_t *group = ctrl + pos;
+        uint32_t matches = group_match(group, h2);
+        while (matches) {
+            size_t index = (pos + __builtin_ctz(matches)) & mask;
+            const HashmapEntry *entry = &entries[index];
+            if (entry->hash == h && entry->key_length == length && memcmp(entry_key(entry), key, length) == 0) {
+                return index;
+            }
+            matches &= matches - 1;
+        }
+        if (group_match_empty(group)) { // an empty slot ends every probe sequence the key could be on
+            return capacity;
+        }
+        stride += HASHMAP_GROUP_WIDTH; // triangular probing visits every group of a power of two table
+        pos = (pos + stride) & mask;
     }
-    return hash % capacity;
 }
 
-void hashmap_resize(Hashmap * hashmap, void (*free_value)(void*)) {
-    // temporaily save the old capacity and old table
-    size_t old_capacity = hashmap->capacity;
-    HashmapEntry **old_table = hashmap->table;
-    
-    // double the capacity of the hashmap
-    hashmap->capacity *= 2;
-    hashmap->table = calloc(hashmap->capacity, sizeof(HashmapEntry*));
-    hashmap->length = 0;
+/* Returns the first EMPTY or DELETED slot of the current table on the probe sequence of h */
+static size_t find_insert_slot(const Hashmap *hashmap, uint64_t h) {
+    size_t mask = hashmap->capacity - 1;
+    size_t pos = hash_h1(h) & mask;
+    size_t stride = 0;
 
-    if (!hashmap->table) {
-        printf("Hashmap resize failed: Memory allocation error.\n");
-        hashmap->table = old_table;
-        hashmap->capacity = old_capacity;
+    while (1) {
+        uint32_t free_slots = group_match_empty_or_deleted(hashmap->ctrl + pos);
+        if (free_slots) {
+            return (pos + __builtin_ctz(free_slots)) & mask;
+        }
+        stride += HASHMAP_GROUP_WIDTH;
+        pos = (pos + stride) & mask;
+    }
+}
+
+/* Places an entry whose key is not in the map into the current table */
+static void insert_entry(Hashmap *hashmap, const HashmapEntry *entry) {
+    size_t index = find_insert_slot(hashmap, entry->hash);
+    if (hashmap->ctrl[index] == CTRL_DELETED) {
+        hashmap->deleted--;
+    }
+    hashmap->entries[index] = *entry;
+    set_ctrl(hashmap->ctrl, hashmap->capacity, index, hash_h2(entry->hash));
+}
+
+/* ///////////////////////// INCREMENTAL RESIZE ///////////////////////// */
+
+static void free_old_table(Hashmap *hashmap) {
+    free(hashmap->old_ctrl);
+    free(hashmap->old_entries);
+    hashmap->old_ctrl = NULL;
+    hashmap->old_entries = NULL;
+    hashmap->old_capacity = 0;
+    hashmap->old_length = 0;
+    hashmap->migrate_pos = 0;
+}
+
+/*
+Moves the live entries of up to `slots` old table slots into the current table (keys are moved, not copied).
+Migrated slots become DELETED so a key deleted from the new table can not be found again in the old one.
+*/
+static void migrate(Hashmap *hashmap, size_t slots) {
+    if (!hashmap->old_ctrl) {
         return;
     }
-    
-    // Begin rehashing to new table and free the old table
+    size_t end = hashmap->migrate_pos + slots;
+    if (end > hashmap->old_capacity) {
+        end = hashmap->old_capacity;
+    }
+
     size_t i;
-    for (i=0; i < old_capacity; i++) {
-        HashmapEntry * entry = old_table[i]; 
-        while (entry) { 
-            hashmap_set(hashmap, entry->key, entry->value, free_value);
-
-            free(entry->key);  // free old key as hashmap_set duplicates it
-            free(entry);
-            entry = entry->next;
+    for (i = hashmap->migrate_pos; i < end && hashmap->old_length > 0; i++) {
+        if (hashmap->old_ctrl[i] >= 0) {
+            insert_entry(hashmap, &hashmap->old_entries[i]);
+            set_ctrl(hashmap->old_ctrl, hashmap->old_capacity, i, CTRL_DELETED);
+            hashmap->old_length--;
         }
     }
+    hashmap->migrate_pos = i;
 
-    free(old_table);
+    if (hashmap->old_length == 0) {
+        free_old_table(hashmap);
+    }
+}
+
+/* Makes freshly allocated arrays of new_capacity slots the current table, the previous one is migrated lazily */
+static int start_resize(Hashmap *hashmap, size_t new_capacity) {
+    migrate(hashmap, hashmap->old_capacity); // at most one resize is in flight, finish the previous one
+
+    int8_t *ctrl = malloc(new_capacity + HASHMAP_GROUP_WIDTH);
+    HashmapEntry *entries = malloc(new_capacity * sizeof(HashmapEntry));
+    if (!ctrl || !entries) {
+        printf("Hashmap resize failed: Memory allocation error.\n");
+        free(ctrl);
+        free(entries);
+        return 0;
+    }
+    memset(ctrl, CTRL_EMPTY, new_capacity + HASHMAP_GROUP_WIDTH);
+
+    hashmap->old_ctrl = hashmap->ctrl;
+    hashmap->old_entries = hashmap->entries;
+    hashmap->old_capacity = hashmap->capacity;
+    hashmap->old_length = hashmap->length;
+    hashmap->migrate_pos = 0;
+
+    hashmap->ctrl = ctrl;
+    hashmap->entries = entries;
+    hashmap->capacity = new_capacity;
+    hashmap->deleted = 0;
+
+    if (hashmap->old_length == 0) {
+        free_old_table(hashmap);
+    }
+    return 1;
+}
+
+/*
+Finds key in the current table, then in the old one while a resize is in progress.
+Returns NULL if it is in neither, *in_old tells which table the returned entry lives in.
+*/
+static HashmapEntry *find_entry(Hashmap *hashmap, const char *key, size_t length, uint64_t h,
+                                size_t *index, int *in_old) {
+    *in_old = 0;
+    *index = find_slot(hashmap->ctrl, hashmap->entries, hashmap->capacity, key, length, h);
+    if (*index != hashmap->capacity) {
+        return &hashmap->entries[*index];
+    }
+    if (hashmap->old_ctrl) {
+        *in_old = 1;
+        *index = find_slot(hashmap->old_ctrl, hashmap->old_entries, hashmap->old_capacity, key, length, h);
+        if (*index != hashmap->old_capacity) {
+            return &hashmap->old_entries[*index];
+        }
+    }
+    return NULL;
+}
+
+/* ///////////////////////// HASHMAP ///////////////////////// */
+Hashmap * init_hashmap(size_t capacity) {
+    Hashmap * hashmap = malloc(sizeof(Hashmap));
+    if (! hashmap) { // ensure that we can allocate space for the hashmap
+        printf("Hashmap allocation failed\n");
+        return NULL;
+    }
+    hashmap->capacity = round_capacity(capacity);
+    hashmap->length = 0;
+    hashmap->deleted = 0;
+    hashmap->old_ctrl = NULL;
+    hashmap->old_entries = NULL;
+    hashmap->old_capacity = 0;
+    hashmap->old_length = 0;
+    hashmap->migrate_pos = 0;
+    hashmap->ctrl = malloc(hashmap->capacity + HASHMAP_GROUP_WIDTH);
+    hashmap->entries = malloc(hashmap->capacity * sizeof(HashmapEntry)); // slots are only read once their control byte is set
+    if (!hashmap->ctrl || !hashmap->entries) {
+        printf("Hashmap allocation failed\n");
+        free(hashmap->ctrl);
+        free(hashmap->entries);
+        free(hashmap);
+        return NULL;
+    }
+    memset(hashmap->ctrl, CTRL_EMPTY, hashmap->capacity + HASHMAP_GROUP_WIDTH);
+    return hashmap;
 }
 
-// unint32_t is as used since we can resonably expect that there will not be more than 2^32 variables declared by any single running program.
+/*
+Doubles the capacity. Entries are migrated by the following operations, values are moved as is so
+free_value is never called (kept for API compatibility)
+*/
+void hashmap_resize(Hashmap * hashmap, void (*free_value)(void*)) {
+    (void)free_value;
+    start_resize(hashmap, hashmap->capacity * 2);
+}
 
 /*
 Sets a char * "key" to a specified void * "value". DOES NOT free the key.
 key needs to be explictly freed after calling hashmap_set
 */
 void hashmap_set(Hashmap * hashmap, const char * key, void * value, void (*free_value)(void*)) {
-    // Check if the hashmap occupancy exceeds the tolerance 
-    float tolerance = 0.85;
-    float occupancy = (float) hashmap->length/ (float) hashmap->capacity;
-    if (occupancy > tolerance) {
-        hashmap_resize(hashmap, free_value);
-    }
+    size_t length = strlen(key);
+    hashmap_set_prehashed(hashmap, key, length, hashmap_hash(key, length), value, free_value);
+}
 
-    size_t index = hash(key, hashmap->capacity);
-    HashmapEntry * entry = hashmap->table[index];
+/*
+Same as hashmap_set, but with the key length and hashmap_hash(key, length) supplied by the caller.
+key does not have to be NUL terminated, a terminated copy is stored on insertion.
+*/
+void hashmap_set_prehashed(Hashmap * hashmap, const char * key, size_t length, uint64_t h, void * value, void (*free_value)(void*)) {
+    migrate(hashmap, HASHMAP_MIGRATE_SLOTS);
 
-    // check if a key exists:
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            if (free_value) {
-                free_value(entry->value);  // free if needed.
-            }
-            entry->value = value;
+    // check if a key exists (in either table):
+    size_t index;
+    int in_old;
+    HashmapEntry *existing = find_entry(hashmap, key, length, h, &index, &in_old);
+    if (existing) {
+        if (free_value) {
+            free_value(existing->value);  // free if needed.
+        }
+        existing->value = value;
+        return;
+    }
+
+    // Keep at least one EMPTY slot per probe sequence of the current table: grow when full, or just clean out tombstones
+    size_t used = hashmap->length - hashmap->old_length + hashmap->deleted;
+    if ((used + 1) * MAX_LOAD_DEN > hashmap->capacity * MAX_LOAD_NUM) {
+        size_t new_capacity = hashmap->capacity;
+        if ((hashmap->length + 1) * MAX_LOAD_DEN * 2 > hashmap->capacity * MAX_LOAD_NUM) {
+            new_capacity *= 2;
+        }
+        if (!start_resize(hashmap, new_capacity)) {
             return;
         }
-        entry = entry->next; // key does not exist and hash collision has occured start a new entry
+        migrate(hashmap, HASHMAP_MIGRATE_SLOTS);
     }
 
     // add in the new entry
-    entry = malloc(sizeof(HashmapEntry));
-    entry->key = strdup(key);
-    entry->value = value;
-    entry->next = hashmap->table[index]; // As we calloced the memory in the table, if this is the first entry .next will be set to NULL, else it will be become the head of the previous hashmap entries
-    hashmap->table[index] = entry; // set the entry head as the new pointer reference
-    hashmap->length++; // increment the count to keep track of length of hashmap (not really used but good to have)
+    HashmapEntry entry;
+    char *stored_key = entry.key.inline_key;
+    if (length >= HASHMAP_INLINE_KEY) {
+        stored_key = malloc(length + 1);
+        if (!stored_key) {
+            printf("Hashmap insert failed: Memory allocation error.\n");
+            return;
+        }
+        entry.key.heap_key = stored_key;
+    }
+    memcpy(stored_key, key, length);
+    stored_key[length] = '\0';
+    entry.hash = h;
+    entry.value = value;
+    entry.key_length = (uint32_t)length;
+    insert_entry(hashmap, &entry);
+    hashmap->length++; // increment the count to keep track of length of hashmap
 }
 
 /*
@@ -100,64 +419,80 @@ Gets the value of char * key. DOES NOT free the key.
 key needs to explicitly freed after calling hashmap_get
 */
 void * hashmap_get(Hashmap * hashmap, const char * key) {
-    size_t index = hash(key, hashmap->capacity);
-    HashmapEntry * entry = hashmap->table[index];
+    size_t length = strlen(key);
+    return hashmap_get_prehashed(hashmap, key, length, hashmap_hash(key, length));
+}
 
-    while (entry) {
-        if (strcmp(entry->key, key) == 0) {
-            return entry->value;    // remember that we are returning a void pointer so it must be cast and handled appropriately
-        }
-        entry = entry->next; 
+/* Same as hashmap_get, but with the key length and hashmap_hash(key, length) supplied by the caller */
+void * hashmap_get_prehashed(Hashmap * hashmap, const char * key, size_t length, uint64_t h) {
+    migrate(hashmap, HASHMAP_MIGRATE_SLOTS);
+
+    size_t index;
+    int in_old;
+    HashmapEntry *entry = find_entry(hashmap, key, length, h, &index, &in_old);
+    if (!entry) {
+        return NULL; // if value is not found
     }
-    return NULL; // if value is not found
+    return entry->value; // remember that we are returning a void pointer so it must be cast and handled appropriately
 }
 
 // When used in global table, we will not expect to be deleting any variables
 // void (*free_value) (void*) is a function pointer to any function that will be used to free the value as we are storing void pointers which would have to be handled individually
 void hashmap_delete(Hashmap * hashmap, const char * key, void (*free_value)(void*)) { 
-    size_t index = hash(key, hashmap->capacity);
-    HashmapEntry * entry = hashmap->table[index];
-    HashmapEntry * prev = NULL;
-
-    while (entry) {
-        // handle linked list reattachment if possible
-        if (strcmp(entry->key, key) == 0) { // if there is a key match
-            if (prev) {
-                prev->next = entry->next; // if the entry is a middle value in the linked list re-attach the ends (should have made a doubly linked list)
-            } else {
-                hashmap->table[index] = entry->next; // if the entry to be removed is the first (or only) entry just set its next value as the new head (will be NULL pointer if it is the onlyt entry)
-            }
-            if (free_value) { // only run this if given a function pointer for freeing certain values. (if the value stored does not need to be freedm NULL will be passed into the argument)
-                free_value(entry->value);
-            }
-            free(entry->key); // free the string that was used as the name
-            free(entry); // free the entry itself
-            hashmap->length--;
-            return;
-        }
-        // key has not been found yet
-        prev = entry; // keep track of last checked entry
-        entry = entry->next;
+    size_t length = strlen(key);
+    hashmap_delete_prehashed(hashmap, key, length, hashmap_hash(key, length), free_value);
+}
+
+/* Same as hashmap_delete, but with the key length and hashmap_hash(key, length) supplied by the caller */
+void hashmap_delete_prehashed(Hashmap * hashmap, const char * key, size_t length, uint64_t h, void (*free_value)(void*)) {
+    migrate(hashmap, HASHMAP_MIGRATE_SLOTS);
+
+    size_t index;
+    int in_old;
+    HashmapEntry *entry = find_entry(hashmap, key, length, h, &index, &in_old);
+    if (!entry) {
+        printf("Key \"%.*s\" does not exist.\n", (int)length, key);
+        return;
+    }
+
+    if (free_value) { // only run this if given a function pointer for freeing certain values.
+        free_value(entry->value);
+    }
+    free_entry_key(entry);
+    // a tombstone keeps probe sequences running through this slot intact
+    if (in_old) {
+        set_ctrl(hashmap->old_ctrl, hashmap->old_capacity, index, CTRL_DELETED);
+        hashmap->old_length--;
+    } else {
+        set_ctrl(hashmap->ctrl, hashmap->capacity, index, CTRL_DELETED);
+        hashmap->deleted++;
+    }
+    hashmap->length--;
+    if (hashmap->old_ctrl && hashmap->old_length == 0) {
+        free_old_table(hashmap);
     }
-    printf("Key \"%s\" does not exist.\n", key); // return NULL to indicate that a key cannot be found
-    return;
 }
 
-/* Hashmap should not need to be freed in the case of the global table as it is never expected to be resized */
-void free_hashmap(Hashmap * hashmap, void (*free_value)(void*)) {
+/* Frees the live entries of one table (ctrl, entries, capacity) */
+static void free_table(int8_t *ctrl, HashmapEntry *entries, size_t capacity, void (*free_value)(void*)) {
     size_t i;
-    for (i=0; i < hashmap->capacity; i++) {
-        HashmapEntry * entry = hashmap->table[i]; 
-        while (entry) {        
-            if (free_value){
-                free_value(entry->value);
+    for (i = 0; i < capacity; i++) {
+        if (ctrl[i] >= 0) {
+            if (free_value) {
+                free_value(entries[i].value);
             }
-            free(entry->key);
-            free(entry);
-            entry = entry->next;
+            free_entry_key(&entries[i]);
         }
     }
-    free(hashmap->table);
+    free(ctrl);
+    free(entries);
+}
+
+void free_hashmap(Hashmap * hashmap, void (*free_value)(void*)) {
+    if (hashmap->old_ctrl) {
+        free_table(hashmap->old_ctrl, hashmap->old_entries, hashmap->old_capacity, free_value);
+    }
+    free_table(hashmap->ctrl, hashmap->entries, hashmap->capacity, free_value);
     free(hashmap);
 }
-/* ///////////////////////// HASHMAP ///////////////////////// */
\ No newline at end of file
+/* ///////////////////////// HASHMAP ///////////////////////// */
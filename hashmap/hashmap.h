@@ -4,18 +4,46 @@
 #include <stdlib.h>
 #include <stdint.h>
 
+/*
+Open addressing hashmap (swiss table layout).
+Every slot has a control byte: EMPTY, DELETED or the low 7 bits of the key's hash when occupied.
+Lookups compare 16 control bytes at a time (SSE2 when available) and only touch the entries whose
+control byte matches, then compare the cached full hash before the key bytes.
+*/
+
+#define HASHMAP_GROUP_WIDTH 16  // control bytes probed at once
+#define HASHMAP_INLINE_KEY 24   // keys shorter than this are stored inside the entry, longer keys are heap allocated
+#define HASHMAP_MIGRATE_SLOTS 32 // old table slots moved per operation while a resize is in progress
+
 /* Define your HashmapEntry structure */
 typedef struct HashmapEntry {
-    char *key;
+    uint64_t hash;        // full hash of the key
     void *value;
-    struct HashmapEntry *next;
+    uint32_t key_length;
+    union {
+        char inline_key[HASHMAP_INLINE_KEY]; // NUL terminated, used when key_length < HASHMAP_INLINE_KEY
+        char *heap_key;
+    } key;
 } HashmapEntry;
 
-/* Define your Hashmap structure */
+/*
+Define your Hashmap structure
+Resizing is incremental: the old table is kept next to the new one and every set/get/delete migrates at most
+HASHMAP_MIGRATE_SLOTS of its slots, so no single insert pays for moving the whole table.
+Until the old table is empty, keys are looked up in the new table first and then in the old one.
+*/
 typedef struct Hashmap {
-    HashmapEntry **table;
-    size_t capacity;
-    size_t length;
+    int8_t *ctrl;           // capacity + HASHMAP_GROUP_WIDTH control bytes (the first group is mirrored at the end)
+    HashmapEntry *entries;  // capacity slots
+    size_t capacity;        // always a power of two >= HASHMAP_GROUP_WIDTH
+    size_t length;          // live entries in both tables
+    size_t deleted;         // DELETED control bytes (tombstones) of the new table still counted against the load factor
+
+    int8_t *old_ctrl;           // table being migrated away from (NULL when no resize is in progress)
+    HashmapEntry *old_entries;
+    size_t old_capacity;
+    size_t old_length;          // live entries still in the old table
+    size_t migrate_pos;         // next old slot to migrate
 } Hashmap;
 
 /* Function Declarations */
@@ -27,4 +55,14 @@ void    hashmap_delete(Hashmap *hashmap, const char *key, void (*free_value)(voi
 void    free_hashmap(Hashmap *hashmap, void (*free_value)(void*));
 size_t  hash(const char* str, size_t capacity);
 
-#endif
\ No newline at end of file
+/* Variants for callers that already know the key length and hashmap_hash(key, length), e.g. ID operands in the bytecode */
+void    hashmap_set_prehashed(Hashmap *hashmap, const char *key, size_t length, uint64_t hash, void *value, void (*free_value)(void*));
+void*   hashmap_get_prehashed(Hashmap *hashmap, const char *key, size_t length, uint64_t hash);
+void    hashmap_delete_prehashed(Hashmap *hashmap, const char *key, size_t length, uint64_t hash, void (*free_value)(void*));
+uint64_t hashmap_hash(const char *key, size_t length); // keyed SipHash-1-3
+
+/* Hash key selection. Must be called before any hashmap is filled, keys hashed with another seed are not found */
+void    hashmap_random_seed(void);        // per process random key (fixed if built with -DHASHMAP_SEED=<n>)
+void    hashmap_set_seed(uint64_t seed);  // deterministic key, e.g. for reproducible runs
+
+#endif
@@ -0,0 +1,89 @@
+/*
+Collision stress benchmark for the hashmap (build with `make hashmap_bench`).
+
+Keys are built from the blocks "Ez" and "FY", which have the same DJB2 state ('E'*33+'z' == 'F'*33+'Y'),
+so every key of the same length collides under the previous unkeyed DJB2 hash. The table below shows the
+lookup cost of those keys with the seeded hash, with plain sequential keys, and (through the prehashed API)
+with DJB2, which degrades to a linear scan of all keys.
+*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "hashmap.h"
+
+#define MAX_KEYS 16384
+#define LOOKUP_ROUNDS 8
+
+static double now(void) {
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* The hash used before keyed hashing (DJB2, seed 4123). Colliding keys collide on the whole 64 bits */
+static uint64_t djb2(const char *key, size_t length) {
+    uint64_t h = 4123;
+    for (size_t i = 0; i < length; i++) {
+        h = ((h << 5) + h) + (uint8_t)key[i];
+    }
+    return h;
+}
+
+/* Key i of the colliding family: bit b of i picks "Ez" or "FY" for block b (14 blocks cover MAX_KEYS) */
+static void colliding_key(char *out, size_t i) {
+    for (int b = 0; b < 14; b++) {
+        memcpy(out + 2 * b, (i >> b) & 1 ? "FY" : "Ez", 2);
+    }
+    out[28] = '\0';
+}
+
+static void sequential_key(char *out, size_t i) {
+    sprintf(out, "var_%zu", i);
+}
+
+/* Average nanoseconds per lookup over n keys, hashing with djb2 instead of hashmap_hash when legacy is set */
+static double bench(char (*keys)[32], size_t n, int legacy) {
+    Hashmap *map = init_hashmap(16);
+    for (size_t i = 0; i < n; i++) {
+        size_t length = strlen(keys[i]);
+        uint64_t h = legacy ? djb2(keys[i], length) : hashmap_hash(keys[i], length);
+        hashmap_set_prehashed(map, keys[i], length, h, (void *)(keys[i]), NULL);
+    }
+
+    size_t found = 0;
+    double start = now();
+    for (int round = 0; round < LOOKUP_ROUNDS; round++) {
+        for (size_t i = 0; i < n; i++) {
+            size_t length = strlen(keys[i]);
+            uint64_t h = legacy ? djb2(keys[i], length) : hashmap_hash(keys[i], length);
+            found += hashmap_get_prehashed(map, keys[i], length, h) == keys[i];
+        }
+    }
+    double elapsed = now() - start;
+
+    if (found != n * LOOKUP_ROUNDS) {
+        printf("Error: %zu of %zu lookups failed.\n", n * LOOKUP_ROUNDS - found, n * LOOKUP_ROUNDS);
+        exit(EXIT_FAILURE);
+    }
+    free_hashmap(map, NULL);
+    return elapsed / (n * LOOKUP_ROUNDS) * 1e9;
+}
+
+int main(void) {
+    static char colliding[MAX_KEYS][32];
+    static char sequential[MAX_KEYS][32];
+    for (size_t i = 0; i < MAX_KEYS; i++) {
+        colliding_key(colliding[i], i);
+        sequential_key(sequential[i], i);
+    }
+
+    hashmap_random_seed();
+
+    printf("%8s %18s %18s %18s\n", "keys", "seeded/colliding", "seeded/sequential", "djb2/colliding");
+    for (size_t n = 256; n <= MAX_KEYS; n *= 4) {
+        printf("%8zu %15.1f ns %15.1f ns %15.1f ns\n", n,
+               bench(colliding, n, 0), bench(sequential, n, 0), bench(colliding, n, 1));
+    }
+    return 0;
+}
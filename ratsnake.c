@@ -4,18 +4,25 @@
 #include <libgen.h> 
 #include "vm/vm.h"
 
-int compile_ir(const char *input_path, const char *output_path);
+int compile_ir(const char *input_path, const char *output_path, uint32_t flags);
 
 int main(int argc, char const *argv[]) {
     int keep_ir = 0;
     int keep_bin = 0;
+    int memo_stats = 0;
+    int record_mode = 0;
+    int hash_seeded = 0;
+    uint32_t bytecode_flags = 0;
+    long long output_buffer = -1; // -1 keeps OUTPUT_BUFFER_DEFAULT
+    long inline_size = -1;  // -1 keeps the frontend's default budgets
+    long inline_depth = -1;
     const char *source_file = NULL;
     char *bytecode_file = NULL;
     char *output_bin = NULL;
     VM *vm = NULL;
 
-    if (argc < 2 || argc > 4) {
-        fprintf(stderr, "Usage: %s [-keep_ir] [-keep_bin] <source_file.rtsk>\n", argv[0]);
+    if (argc < 2 || argc > 11) {
+        fprintf(stderr, "Usage: %s [-keep_ir] [-keep_bin] [-memo-stats] [-hash-seed=N] [-obuf=SIZE] [-n] [-compact] [-inline-size=BYTES] [-inline-depth=N] <source_file.rtsk>\n", argv[0]);
         goto cleanup;
     }
 
@@ -25,6 +32,35 @@ int main(int argc, char const *argv[]) {
             keep_ir = 1;
         } else if (strcmp(argv[i], "-keep_bin") == 0) {
             keep_bin = 1;
+        } else if (strcmp(argv[i], "-memo-stats") == 0) {
+            memo_stats = 1;
+        } else if (strcmp(argv[i], "-n") == 0) {
+            record_mode = 1;
+        } else if (strcmp(argv[i], "-compact") == 0) {
+            bytecode_flags |= BYTECODE_FLAG_COMPACT;
+        } else if (strncmp(argv[i], "-hash-seed=", 11) == 0) {
+            hashmap_set_seed(strtoull(argv[i] + 11, NULL, 0));
+            hash_seeded = 1;
+        } else if (strncmp(argv[i], "-obuf=", 6) == 0) {
+            char *end;
+            output_buffer = strtoll(argv[i] + 6, &end, 0);
+            if (end == argv[i] + 6 || *end != '\0' || output_buffer < 0) {
+                fprintf(stderr, "Error: Invalid output buffer size: %s\n", argv[i] + 6);
+                goto cleanup;
+            }
+        } else if (strncmp(argv[i], "-inline-size=", 13) == 0 || strncmp(argv[i], "-inline-depth=", 14) == 0) {
+            const char *value = strchr(argv[i], '=') + 1;
+            char *end;
+            long budget = strtol(value, &end, 0);
+            if (end == value || *end != '\0' || budget < 0) {
+                fprintf(stderr, "Error: Invalid inline budget: %s\n", argv[i]);
+                goto cleanup;
+            }
+            if (argv[i][8] == 's') {
+                inline_size = budget;
+            } else {
+                inline_depth = budget;
+            }
         } else if (!source_file) {
             source_file = argv[i];
         } else {
@@ -38,6 +74,11 @@ int main(int argc, char const *argv[]) {
         goto cleanup;
     }
 
+    // The hash seed has to be fixed before compile_ir, which stores identifier hashes in the binary
+    if (!hash_seeded) {
+        hashmap_random_seed();
+    }
+
     const char *ext = strrchr(source_file, '.');
     if (!ext || strcmp(ext, ".rtsk") != 0) {
         fprintf(stderr, "Error: Provided source file is not a .rtsk file.\n");
@@ -73,8 +114,16 @@ int main(int argc, char const *argv[]) {
 
     char *exec_dir = dirname(path_buffer);
     char python_command[1024];
-    snprintf(python_command, sizeof(python_command),
+    int command_length = snprintf(python_command, sizeof(python_command),
              "python \"%s/FrontEndParts/frontend_manager.py\" -i \"%s\"",exec_dir, source_file);
+    if (inline_size >= 0 && command_length >= 0 && (size_t)command_length < sizeof(python_command)) {
+        command_length += snprintf(python_command + command_length, sizeof(python_command) - command_length,
+                                   " --inline-size %ld", inline_size);
+    }
+    if (inline_depth >= 0 && command_length >= 0 && (size_t)command_length < sizeof(python_command)) {
+        snprintf(python_command + command_length, sizeof(python_command) - command_length,
+                 " --inline-depth %ld", inline_depth);
+    }
 
     // Run the Python frontend
     int result = system(python_command);
@@ -84,7 +133,7 @@ int main(int argc, char const *argv[]) {
     }
 
     // Compile IR to binary
-    if (compile_ir(bytecode_file, output_bin) != 0) {
+    if (compile_ir(bytecode_file, output_bin, bytecode_flags) != 0) {
         fprintf(stderr, "IR Compilation failed.\n");
         goto cleanup;
     }
@@ -95,6 +144,11 @@ int main(int argc, char const *argv[]) {
         fprintf(stderr, "VM initialization failed.\n");
         goto cleanup;
     }
+    vm->memo_stats = memo_stats;
+    vm->records.enabled = record_mode;
+    if (output_buffer >= 0 && output_resize(&vm->output, (size_t)output_buffer) != 0) {
+        fprintf(stderr, "Warning: Keeping the default output buffer.\n");
+    }
 
     run(vm, output_bin);
 
@@ -0,0 +1,682 @@
+#include "builtins.h"
+#include "native.h"
+#include "event_loop.h"
+#include "../CorePrimitives/string_kernels.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static StackEntry builtin_error(void) {
+  StackEntry error = {NULL, PRIMITIVE_OBJ};
+  return error;
+}
+
+/* ///////////////////////// STRING BUILDER ///////////////////////// */
+
+static StringBuilder *as_string_builder(StackEntry entry, const char *builtin) {
+  if (entry.entry_type != ADVANCED_OBJ || ((HandleBase *)entry.value)->kind != HANDLE_STRING_BUILDER) {
+    printf("Error: %s expects a string builder created by sb_new().\n", builtin);
+    return NULL;
+  }
+  return (StringBuilder *)entry.value;
+}
+
+/* Makes room for extra more bytes, doubling the capacity so appends are amortised O(1) */
+static int string_builder_reserve(StringBuilder *sb, size_t extra) {
+  if (sb->capacity - sb->length >= extra) {
+    return 1;
+  }
+  size_t capacity = sb->capacity ? sb->capacity : STRING_BUILDER_MIN_CAPACITY;
+  while (capacity - sb->length < extra) {
+    capacity *= 2;
+  }
+  char *buffer = realloc(sb->buffer, capacity);
+  if (!buffer) {
+    printf("Error: Failed to grow string builder to %zu bytes.\n", capacity);
+    return 0;
+  }
+  sb->buffer = buffer;
+  sb->capacity = capacity;
+  return 1;
+}
+
+static StackEntry builtin_sb_new(VM *vm, int argc, StackEntry *args) {
+  (void)vm;
+  (void)argc;
+  (void)args;
+  StringBuilder *sb = malloc(sizeof(StringBuilder));
+  if (!sb) {
+    printf("Error: Failed to allocate string builder.\n");
+    return builtin_error();
+  }
+  sb->base.kind = HANDLE_STRING_BUILDER;
+  sb->buffer = NULL;
+  sb->length = 0;
+  sb->capacity = 0;
+
+  StackEntry result = {sb, ADVANCED_OBJ};
+  return result;
+}
+
+static StackEntry builtin_sb_append(VM *vm, int argc, StackEntry *args) {
+  (void)vm;
+  (void)argc;
+  StringBuilder *sb = as_string_builder(args[0], "sb_append");
+  if (!sb) {
+    return builtin_error();
+  }
+  if (args[1].entry_type != PRIMITIVE_OBJ) {
+    printf("Error: sb_append can only append primitive values.\n");
+    return builtin_error();
+  }
+
+  PrimitiveObject *obj = (PrimitiveObject *)args[1].value;
+  if (obj->type == TYPE_str) {
+    str_Object *str = (str_Object *)obj;
+    if (!string_builder_reserve(sb, str->length)) {
+      return builtin_error();
+    }
+    memcpy(sb->buffer + sb->length, str_value(str), str->length);
+    sb->length += str->length;
+  } else {
+    if (!string_builder_reserve(sb, PRIMITIVE_FORMAT_MAX)) {
+      return builtin_error();
+    }
+    sb->length += format_primitive(obj, sb->buffer + sb->length);
+  }
+  return args[0];
+}
+
+static StackEntry builtin_sb_build(VM *vm, int argc, StackEntry *args) {
+  (void)vm;
+  (void)argc;
+  StringBuilder *sb = as_string_builder(args[0], "sb_build");
+  if (!sb) {
+    return builtin_error();
+  }
+  StackEntry result = {new_str_len(sb->length ? sb->buffer : "", sb->length), PRIMITIVE_OBJ};
+  return result;
+}
+
+/* ///////////////////////// STRINGS ///////////////////////// */
+
+static str_Object *as_str(StackEntry entry, const char *builtin) {
+  if (entry.entry_type != PRIMITIVE_OBJ || ((PrimitiveObject *)entry.value)->type != TYPE_str) {
+    printf("Error: %s expects str arguments.\n", builtin);
+    return NULL;
+  }
+  return (str_Object *)entry.value;
+}
+
+static StackEntry builtin_find(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  str_Object *str = as_str(args[0], "find");
+  str_Object *sub = as_str(args[1], "find");
+  if (!str || !sub) {
+    return builtin_error();
+  }
+  size_t index = sk_find(str_value(str), str->length, str_value(sub), sub->length, 0);
+  StackEntry result = {new_int(vm, index == SK_NOT_FOUND ? -1 : (int64_t)index), PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry builtin_count(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  str_Object *str = as_str(args[0], "count");
+  str_Object *sub = as_str(args[1], "count");
+  if (!str || !sub) {
+    return builtin_error();
+  }
+  StackEntry result = {new_int(vm, (int64_t)sk_count(str_value(str), str->length, str_value(sub), sub->length)),
+                       PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry builtin_split(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  str_Object *str = as_str(args[0], "split");
+  str_Object *sep = as_str(args[1], "split");
+  if (!str || !sep) {
+    return builtin_error();
+  }
+  PrimitiveObject *index_obj = (PrimitiveObject *)args[2].value;
+  if (args[2].entry_type != PRIMITIVE_OBJ || index_obj->type != TYPE_int) {
+    printf("Error: split expects an int field index.\n");
+    return builtin_error();
+  }
+  if (sep->length == 0) {
+    printf("Error: split separator can not be empty.\n");
+    return builtin_error();
+  }
+
+  const char *bytes = str_value(str);
+  const char *sep_bytes = str_value(sep);
+  int64_t index = ((int_Object *)index_obj)->value;
+  if (index < 0) {
+    StackEntry result = {get_null(vm), PRIMITIVE_OBJ};
+    return result;
+  }
+
+  // skip index separators, the field ends at the next one (or at the end of the string)
+  size_t start = 0;
+  for (int64_t i = 0; i < index; i++) {
+    size_t found = sk_find(bytes, str->length, sep_bytes, sep->length, start);
+    if (found == SK_NOT_FOUND) {
+      StackEntry result = {get_null(vm), PRIMITIVE_OBJ};
+      return result;
+    }
+    start = found + sep->length;
+  }
+  size_t end = sk_find(bytes, str->length, sep_bytes, sep->length, start);
+  if (end == SK_NOT_FOUND) {
+    end = str->length;
+  }
+  if (start == 0 && end == str->length) {
+    return args[0];
+  }
+  StackEntry result = {new_str_len(bytes + start, end - start), PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry builtin_replace(VM *vm, int argc, StackEntry *args) {
+  (void)vm;
+  (void)argc;
+  str_Object *str = as_str(args[0], "replace");
+  str_Object *old = as_str(args[1], "replace");
+  str_Object *new = as_str(args[2], "replace");
+  if (!str || !old || !new) {
+    return builtin_error();
+  }
+  if (old->length == 0) {
+    printf("Error: replace can not replace an empty string.\n");
+    return builtin_error();
+  }
+
+  const char *bytes = str_value(str);
+  const char *old_bytes = str_value(old);
+  const char *new_bytes = str_value(new);
+  size_t count = sk_count(bytes, str->length, old_bytes, old->length);
+  if (count == 0) {
+    return args[0]; // strings are immutable, nothing to copy
+  }
+
+  // count first so the result is allocated once and every segment is copied straight into it
+  size_t length = str->length - count * old->length;
+  if (new->length && count > (SIZE_MAX - length) / new->length) {
+    printf("Error: replace result is too large.\n");
+    return builtin_error();
+  }
+  length += count * new->length;
+  if (length < 2) {
+    char small[2];
+    size_t found = sk_find(bytes, str->length, old_bytes, old->length, 0);
+    size_t n = 0;
+    for (size_t pos = 0; pos < str->length;) {
+      if (pos == found) {
+        memcpy(small + n, new_bytes, new->length);
+        n += new->length;
+        pos += old->length;
+        found = sk_find(bytes, str->length, old_bytes, old->length, pos);
+      } else {
+        small[n++] = bytes[pos++];
+      }
+    }
+    StackEntry result = {new_str_len(small, length), PRIMITIVE_OBJ};
+    return result;
+  }
+
+  str_Object *out = alloc_str(length);
+  if (!out) {
+    printf("Error: Failed to allocate string of %zu bytes.\n", length);
+    return builtin_error();
+  }
+  char *dst = out->value;
+  size_t pos = 0;
+  for (size_t i = 0; i < count; i++) {
+    size_t found = sk_find(bytes, str->length, old_bytes, old->length, pos);
+    memcpy(dst, bytes + pos, found - pos);
+    dst += found - pos;
+    memcpy(dst, new_bytes, new->length);
+    dst += new->length;
+    pos = found + old->length;
+  }
+  memcpy(dst, bytes + pos, str->length - pos);
+
+  StackEntry result = {out, PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry builtin_starts_with(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  str_Object *str = as_str(args[0], "starts_with");
+  str_Object *prefix = as_str(args[1], "starts_with");
+  if (!str || !prefix) {
+    return builtin_error();
+  }
+  int matches = prefix->length <= str->length &&
+                memcmp(str_value(str), str_value(prefix), prefix->length) == 0;
+  StackEntry result = {new_bool(vm, matches), PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry builtin_ends_with(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  str_Object *str = as_str(args[0], "ends_with");
+  str_Object *suffix = as_str(args[1], "ends_with");
+  if (!str || !suffix) {
+    return builtin_error();
+  }
+  int matches = suffix->length <= str->length &&
+                memcmp(str_value(str) + str->length - suffix->length, str_value(suffix), suffix->length) == 0;
+  StackEntry result = {new_bool(vm, matches), PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry convert_case(StackEntry arg, const char *builtin, void (*kernel)(char *, const char *, size_t)) {
+  str_Object *str = as_str(arg, builtin);
+  if (!str) {
+    return builtin_error();
+  }
+  if (str->length < 2) {
+    char small[1];
+    kernel(small, str_value(str), str->length);
+    StackEntry result = {new_str_len(small, str->length), PRIMITIVE_OBJ}; // keeps using the shared small strings
+    return result;
+  }
+  str_Object *out = alloc_str(str->length);
+  if (!out) {
+    printf("Error: Failed to allocate string of %zu bytes.\n", str->length);
+    return builtin_error();
+  }
+  kernel(out->value, str_value(str), str->length);
+  StackEntry result = {out, PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry builtin_upper(VM *vm, int argc, StackEntry *args) {
+  (void)vm;
+  (void)argc;
+  return convert_case(args[0], "upper", sk_upper);
+}
+
+static StackEntry builtin_lower(VM *vm, int argc, StackEntry *args) {
+  (void)vm;
+  (void)argc;
+  return convert_case(args[0], "lower", sk_lower);
+}
+
+/* ///////////////////////// FILES ///////////////////////// */
+
+static FileHandle *as_file(StackEntry entry, const char *builtin) {
+  if (entry.entry_type != ADVANCED_OBJ || ((HandleBase *)entry.value)->kind != HANDLE_FILE) {
+    printf("Error: %s expects a file opened by open().\n", builtin);
+    return NULL;
+  }
+  FileHandle *file = (FileHandle *)entry.value;
+  if (file->fd < 0) {
+    printf("Error: %s on a closed file.\n", builtin);
+    return NULL;
+  }
+  return file;
+}
+
+/* Blocks until fd is ready, for files the async builtins made non-blocking */
+static void wait_ready(int fd, short events) {
+  struct pollfd poll_fd = {fd, events, 0};
+  while (poll(&poll_fd, 1, -1) < 0 && errno == EINTR) {
+  }
+}
+
+/* write(2) until everything is out, returns 0 on success */
+static int write_all(int fd, const char *bytes, size_t length) {
+  while (length > 0) {
+    ssize_t written = write(fd, bytes, length);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        wait_ready(fd, POLLOUT);
+        continue;
+      }
+      printf("Error: Failed to write file: %s\n", strerror(errno));
+      return -1;
+    }
+    bytes += written;
+    length -= (size_t)written;
+  }
+  return 0;
+}
+
+int flush_file(FileHandle *file) {
+  size_t length = file->write_length;
+  file->write_length = 0;
+  return write_all(file->fd, file->write_buffer, length);
+}
+
+/* Buffers small writes, anything that does not fit in the buffer is written directly */
+static int write_file(FileHandle *file, const char *bytes, size_t length) {
+  if (FILE_WRITE_BUFFER - file->write_length < length) {
+    if (flush_file(file) != 0) {
+      return -1;
+    }
+    if (length >= FILE_WRITE_BUFFER) {
+      return write_all(file->fd, bytes, length);
+    }
+  }
+  memcpy(file->write_buffer + file->write_length, bytes, length);
+  file->write_length += length;
+  return 0;
+}
+
+static int close_file(VM *vm, FileHandle *file) {
+  async_finish_file(vm, file);
+  int failed = file->writable ? flush_file(file) : 0;
+  if (close(file->fd) != 0) {
+    failed = -1;
+  }
+  file->fd = -1;
+  free(file->write_buffer);
+  file->write_buffer = NULL;
+  input_free(&file->reader);
+
+  for (FileHandle **link = &vm->open_files; *link; link = &(*link)->next) {
+    if (*link == file) {
+      *link = file->next;
+      break;
+    }
+  }
+  return failed;
+}
+
+void close_files(VM *vm) {
+  async_finish_file(vm, NULL);
+  while (vm->open_files) {
+    close_file(vm, vm->open_files);
+  }
+}
+
+static StackEntry builtin_open(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  str_Object *path = as_str(args[0], "open");
+  str_Object *mode = as_str(args[1], "open");
+  if (!path || !mode) {
+    return builtin_error();
+  }
+
+  int flags;
+  const char *mode_bytes = str_cstr(mode);
+  if (strcmp(mode_bytes, "r") == 0) {
+    flags = O_RDONLY;
+  } else if (strcmp(mode_bytes, "w") == 0) {
+    flags = O_WRONLY | O_CREAT | O_TRUNC;
+  } else if (strcmp(mode_bytes, "a") == 0) {
+    flags = O_WRONLY | O_CREAT | O_APPEND;
+  } else {
+    printf("Error: open mode must be \"r\", \"w\" or \"a\", got \"%s\".\n", mode_bytes);
+    return builtin_error();
+  }
+
+  int fd = open(str_cstr(path), flags | O_CLOEXEC, 0666);
+  if (fd < 0) { // missing files are common enough to be handled by the script
+    StackEntry result = {get_null(vm), PRIMITIVE_OBJ};
+    return result;
+  }
+  FileHandle *file = malloc(sizeof(FileHandle));
+  char *write_buffer = flags == O_RDONLY ? NULL : malloc(FILE_WRITE_BUFFER);
+  if (!file || (flags != O_RDONLY && !write_buffer)) {
+    printf("Error: Failed to allocate file handle.\n");
+    free(file);
+    free(write_buffer);
+    close(fd);
+    return builtin_error();
+  }
+  file->base.kind = HANDLE_FILE;
+  file->fd = fd;
+  file->writable = flags != O_RDONLY;
+  input_init(&file->reader, fd);
+  file->write_buffer = write_buffer;
+  file->write_length = 0;
+  file->nonblocking = 0;
+  file->async_events = 0;
+  file->async_wanted = 0;
+  file->next = vm->open_files;
+  vm->open_files = file;
+
+  StackEntry result = {file, ADVANCED_OBJ};
+  return result;
+}
+
+static StackEntry builtin_readline(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  FileHandle *file = as_file(args[0], "readline");
+  if (!file) {
+    return builtin_error();
+  }
+  if (file->writable) {
+    printf("Error: readline on a file opened for writing.\n");
+    return builtin_error();
+  }
+
+  const char *line;
+  size_t length;
+  int status;
+  while ((status = input_read_line(&file->reader, &line, &length)) < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+    wait_ready(file->fd, POLLIN); // the file was used by read_async
+  }
+  if (status < 0) {
+    printf("Error: Failed to read file: %s\n", strerror(errno));
+    return builtin_error();
+  }
+  StackEntry result = {status ? (void *)new_str_len(line, length) : (void *)get_null(vm), PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry write_value(VM *vm, StackEntry *args, const char *builtin, int end_line) {
+  FileHandle *file = as_file(args[0], builtin);
+  if (!file) {
+    return builtin_error();
+  }
+  if (!file->writable) {
+    printf("Error: %s on a file opened for reading.\n", builtin);
+    return builtin_error();
+  }
+  if (args[1].entry_type != PRIMITIVE_OBJ) {
+    printf("Error: %s can only write primitive values.\n", builtin);
+    return builtin_error();
+  }
+
+  PrimitiveObject *obj = (PrimitiveObject *)args[1].value;
+  size_t length;
+  int failed;
+  if (obj->type == TYPE_str) {
+    str_Object *str = (str_Object *)obj;
+    length = str->length;
+    failed = write_file(file, str_value(str), length);
+  } else {
+    char repr[PRIMITIVE_FORMAT_MAX];
+    length = format_primitive(obj, repr);
+    failed = write_file(file, repr, length);
+  }
+  if (!failed && end_line) {
+    failed = write_file(file, "\n", 1);
+    length++;
+  }
+  if (failed) {
+    return builtin_error();
+  }
+  StackEntry result = {new_int(vm, (int64_t)length), PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry builtin_write(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  return write_value(vm, args, "write", 0);
+}
+
+static StackEntry builtin_writeline(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  return write_value(vm, args, "writeline", 1);
+}
+
+static StackEntry builtin_close(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  FileHandle *file = as_file(args[0], "close");
+  if (!file) {
+    return builtin_error();
+  }
+  if (close_file(vm, file) != 0) {
+    printf("Error: Failed to close file.\n");
+    return builtin_error();
+  }
+  StackEntry result = {new_bool(vm, 1), PRIMITIVE_OBJ};
+  return result;
+}
+
+static StackEntry builtin_read_all(VM *vm, int argc, StackEntry *args) {
+  (void)vm;
+  (void)argc;
+  str_Object *path = as_str(args[0], "read_all");
+  if (!path) {
+    return builtin_error();
+  }
+  int fd = open(str_cstr(path), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    printf("Error: Could not open file %s: %s\n", str_cstr(path), strerror(errno));
+    return builtin_error();
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size >= STR_VIEW_MIN) {
+    void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping != MAP_FAILED) { // the mapping lives as long as the process, like every other string
+      close(fd);
+      madvise(mapping, (size_t)st.st_size, MADV_SEQUENTIAL);
+      StackEntry result = {view_str(mapping, (size_t)st.st_size), PRIMITIVE_OBJ};
+      return result;
+    }
+  }
+
+  // pipes, small files and anything that can not be mapped are read into memory
+  StringBuilder contents = {{HANDLE_STRING_BUILDER}, NULL, 0, 0};
+  ssize_t count = -1; // stays negative if the buffer can not grow
+  while (string_builder_reserve(&contents, INPUT_BUFFER_DEFAULT)) {
+    count = read(fd, contents.buffer + contents.length, contents.capacity - contents.length);
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+    if (count <= 0) {
+      break;
+    }
+    contents.length += (size_t)count;
+  }
+  close(fd);
+  if (count != 0) {
+    free(contents.buffer);
+    printf("Error: Failed to read file %s.\n", str_cstr(path));
+    return builtin_error();
+  }
+  StackEntry result = {new_str_len(contents.length ? contents.buffer : "", contents.length), PRIMITIVE_OBJ};
+  free(contents.buffer);
+  return result;
+}
+
+/* ///////////////////////// ASYNC ///////////////////////// */
+
+static StackEntry async_handle(AsyncOp *op) {
+  StackEntry result = {op, ADVANCED_OBJ};
+  return op ? result : builtin_error();
+}
+
+static StackEntry builtin_read_async(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  FileHandle *file = as_file(args[0], "read_async");
+  if (!file) {
+    return builtin_error();
+  }
+  if (file->writable) {
+    printf("Error: read_async on a file opened for writing.\n");
+    return builtin_error();
+  }
+  return async_handle(async_read_line(vm, file));
+}
+
+static StackEntry builtin_write_async(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  FileHandle *file = as_file(args[0], "write_async");
+  if (!file) {
+    return builtin_error();
+  }
+  if (!file->writable) {
+    printf("Error: write_async on a file opened for reading.\n");
+    return builtin_error();
+  }
+  if (args[1].entry_type != PRIMITIVE_OBJ) {
+    printf("Error: write_async can only write primitive values.\n");
+    return builtin_error();
+  }
+
+  PrimitiveObject *obj = (PrimitiveObject *)args[1].value;
+  if (obj->type == TYPE_str) {
+    str_Object *str = (str_Object *)obj;
+    return async_handle(async_write(vm, file, str_value(str), str->length));
+  }
+  char repr[PRIMITIVE_FORMAT_MAX];
+  return async_handle(async_write(vm, file, repr, format_primitive(obj, repr)));
+}
+
+static StackEntry builtin_sleep_async(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  PrimitiveObject *ms = (PrimitiveObject *)args[0].value;
+  if (args[0].entry_type != PRIMITIVE_OBJ || ms->type != TYPE_int) {
+    printf("Error: sleep_async expects an int number of milliseconds.\n");
+    return builtin_error();
+  }
+  return async_handle(async_sleep(vm, ((int_Object *)ms)->value));
+}
+
+static StackEntry builtin_await(VM *vm, int argc, StackEntry *args) {
+  (void)argc;
+  if (args[0].entry_type != ADVANCED_OBJ || ((HandleBase *)args[0].value)->kind != HANDLE_ASYNC) {
+    printf("Error: await expects a handle returned by an async builtin.\n");
+    return builtin_error();
+  }
+  AsyncOp *op = (AsyncOp *)args[0].value;
+  if (async_await(vm, op) != 0) {
+    return builtin_error();
+  }
+  return op->result;
+}
+
+/* ///////////////////////// REGISTRATION ///////////////////////// */
+
+int register_builtins(VM *vm) {
+  int failed = 0;
+  failed |= register_native(vm, "sb_new", 0, builtin_sb_new);
+  failed |= register_native(vm, "sb_append", 2, builtin_sb_append);
+  failed |= register_native(vm, "sb_build", 1, builtin_sb_build);
+  failed |= register_native(vm, "find", 2, builtin_find);
+  failed |= register_native(vm, "count", 2, builtin_count);
+  failed |= register_native(vm, "split", 3, builtin_split);
+  failed |= register_native(vm, "replace", 3, builtin_replace);
+  failed |= register_native(vm, "starts_with", 2, builtin_starts_with);
+  failed |= register_native(vm, "ends_with", 2, builtin_ends_with);
+  failed |= register_native(vm, "upper", 1, builtin_upper);
+  failed |= register_native(vm, "lower", 1, builtin_lower);
+  failed |= register_native(vm, "open", 2, builtin_open);
+  failed |= register_native(vm, "readline", 1, builtin_readline);
+  failed |= register_native(vm, "write", 2, builtin_write);
+  failed |= register_native(vm, "writeline", 2, builtin_writeline);
+  failed |= register_native(vm, "close", 1, builtin_close);
+  failed |= register_native(vm, "read_all", 1, builtin_read_all);
+  failed |= register_native(vm, "read_async", 1, builtin_read_async);
+  failed |= register_native(vm, "write_async", 2, builtin_write_async);
+  failed |= register_native(vm, "sleep_async", 1, builtin_sleep_async);
+  failed |= register_native(vm, "await", 1, builtin_await);
+  return failed;
+}
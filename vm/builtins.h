@@ -0,0 +1,105 @@
+#ifndef BUILTINS_H
+#define BUILTINS_H
+
+#include "vm.h"
+#include "input.h"
+
+/*
+Builtin functions.
+
+Builtins are native functions (see native.h) registered by initVM, so scripts call them like any other function.
+The semantic checker knows their names and arities (BUILTIN_FUNCTIONS in custom_semantic_checker.py), keep both
+lists in sync.
+
+Values that are not primitives are pushed as ADVANCED_OBJ and start with a HandleBase telling them apart.
+*/
+
+typedef enum {
+  HANDLE_STRING_BUILDER,
+  HANDLE_FILE,
+  HANDLE_ASYNC,
+} HandleKind;
+
+typedef struct {
+  HandleKind kind;
+} HandleBase;
+
+/* ///////////////////////// STRING BUILDER ///////////////////////// */
+/*
+sb_new()           -> new empty builder
+sb_append(sb, x)   -> appends x (strings as is, other primitives through __str__), returns sb
+sb_build(sb)       -> str with everything appended so far, the builder stays usable
+*/
+
+#define STRING_BUILDER_MIN_CAPACITY 64
+
+typedef struct {
+  HandleBase base;
+  char *buffer;     // grows geometrically, not NUL terminated
+  size_t length;
+  size_t capacity;
+} StringBuilder;
+
+/* ///////////////////////// STRINGS ///////////////////////// */
+/*
+Search kernels are in CorePrimitives/string_kernels.c (SSE2/AVX2 picked at runtime).
+
+find(s, sub)           -> index of the first sub in s, -1 if there is none
+count(s, sub)          -> number of non-overlapping sub in s
+split(s, sep, i)       -> i-th field of s split on sep, NULL past the last field (there is no list type yet,
+                          count(s, sep) + 1 is the number of fields)
+replace(s, old, new)   -> s with every old replaced by new
+starts_with(s, prefix) -> bool
+ends_with(s, suffix)   -> bool
+upper(s) / lower(s)    -> ascii case conversion
+*/
+
+/* ///////////////////////// FILES ///////////////////////// */
+/*
+open(path, mode)  -> file handle, mode is "r", "w" (truncates) or "a". NULL if the file can not be opened
+readline(f)       -> next line without its '\n', NULL at the end of the file
+write(f, x)       -> writes x (strings as is, other primitives through __str__), returns the number of bytes
+writeline(f, x)   -> write(f, x) followed by a '\n' (string literals have no escape sequences)
+close(f)          -> flushes and closes f, returns true
+read_all(path)    -> contents of the file as a str. Regular files are mapped read-only and the string is a view of
+                     the mapping (no copy, the file must not be truncated while the script runs)
+
+Reads go through the same buffered reader as input(), writes are buffered per file. The vm keeps every open file
+in vm->open_files and closes them (flushing pending writes) when it stops.
+*/
+
+#define FILE_WRITE_BUFFER (64 * 1024)
+
+typedef struct FileHandle {
+  HandleBase base;
+  int fd; // -1 once closed
+  int writable;
+  InputReader reader;
+  char *write_buffer; // allocated on the first write, not NUL terminated
+  size_t write_length;
+  int nonblocking;        // O_NONBLOCK is set once the file is used by an async builtin
+  uint32_t async_events;  // epoll events the event loop watches the file for
+  uint32_t async_wanted;
+  struct FileHandle *next; // in vm->open_files
+} FileHandle;
+
+// Writes out the bytes buffered by write(). Returns 0 on success.
+int flush_file(FileHandle *file);
+
+// Closes every file still open, writing out what is buffered (including pending async writes).
+void close_files(VM *vm);
+
+/* ///////////////////////// ASYNC ///////////////////////// */
+/*
+Overlapping I/O, see event_loop.h. Each builtin returns a handle at once, await(h) returns its result.
+
+read_async(f)      -> handle of the next line of f (NULL at the end of the file)
+write_async(f, x)  -> handle of writing x to f, resolves to the number of bytes
+sleep_async(ms)    -> handle that resolves to NULL after ms milliseconds
+await(h)           -> runs the event loop until h is done and returns its result (again on later awaits)
+*/
+
+// Registers every builtin function in vm->functions. Returns 0 on success.
+int register_builtins(VM *vm);
+
+#endif
@@ -0,0 +1,297 @@
+#include "event_loop.h"
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <time.h>
+#include <unistd.h>
+
+#define EVENT_BATCH 64 // epoll events taken per wait
+
+typedef enum {
+  ASYNC_DONE,
+  ASYNC_BLOCKED,
+} OpStatus;
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static EventLoop *get_loop(VM *vm) {
+  if (vm->events) {
+    return vm->events;
+  }
+  EventLoop *loop = malloc(sizeof(EventLoop));
+  if (!loop) {
+    printf("Error: Failed to allocate event loop.\n");
+    return NULL;
+  }
+  loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epoll_fd < 0) {
+    printf("Error: Failed to create event loop: %s\n", strerror(errno));
+    free(loop);
+    return NULL;
+  }
+  loop->pending = NULL;
+  loop->pending_tail = NULL;
+  vm->events = loop;
+  return loop;
+}
+
+/* Async operations need a descriptor that returns EAGAIN instead of blocking (the sync builtins cope with that) */
+static int make_nonblocking(FileHandle *file) {
+  if (file->nonblocking) {
+    return 0;
+  }
+  int flags = fcntl(file->fd, F_GETFL);
+  if (flags < 0 || fcntl(file->fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+    printf("Error: Failed to make file non-blocking: %s\n", strerror(errno));
+    return -1;
+  }
+  file->nonblocking = 1;
+  return 0;
+}
+
+static AsyncOp *new_op(VM *vm, AsyncKind kind, FileHandle *file) {
+  EventLoop *loop = get_loop(vm);
+  if (!loop || (file && make_nonblocking(file) != 0)) {
+    return NULL;
+  }
+  AsyncOp *op = malloc(sizeof(AsyncOp));
+  if (!op) {
+    printf("Error: Failed to allocate async operation.\n");
+    return NULL;
+  }
+  op->base.kind = HANDLE_ASYNC;
+  op->kind = kind;
+  op->done = 0;
+  op->result.value = NULL;
+  op->result.entry_type = PRIMITIVE_OBJ;
+  op->file = file;
+  op->data = NULL;
+  op->length = 0;
+  op->written = 0;
+  op->deadline = 0;
+  op->next = NULL;
+
+  if (loop->pending_tail) {
+    loop->pending_tail->next = op;
+  } else {
+    loop->pending = op;
+  }
+  loop->pending_tail = op;
+  return op;
+}
+
+/* ///////////////////////// OPERATIONS ///////////////////////// */
+
+static OpStatus try_read_line(VM *vm, AsyncOp *op) {
+  const char *line;
+  size_t length;
+  int status = input_read_line(&op->file->reader, &line, &length);
+  if (status < 0) {
+    if (errno == EAGAIN || errno == EWOULDBLOCK) {
+      return ASYNC_BLOCKED;
+    }
+    printf("Error: Failed to read file: %s\n", strerror(errno));
+    return ASYNC_DONE; // result stays NULL
+  }
+  op->result.value = status ? (void *)new_str_len(line, length) : (void *)get_null(vm);
+  return ASYNC_DONE;
+}
+
+static OpStatus try_write(VM *vm, AsyncOp *op) {
+  if (op->file->write_length > 0 && flush_file(op->file) != 0) { // bytes of earlier sync writes go first
+    return ASYNC_DONE;
+  }
+  while (op->written < op->length) {
+    ssize_t count = write(op->file->fd, op->data + op->written, op->length - op->written);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EAGAIN || errno == EWOULDBLOCK) {
+        return ASYNC_BLOCKED;
+      }
+      printf("Error: Failed to write file: %s\n", strerror(errno));
+      return ASYNC_DONE;
+    }
+    op->written += (size_t)count;
+  }
+  op->result.value = new_int(vm, (int64_t)op->length);
+  return ASYNC_DONE;
+}
+
+static OpStatus try_op(VM *vm, AsyncOp *op, uint64_t now) {
+  switch (op->kind) {
+  case ASYNC_READ_LINE:
+    return try_read_line(vm, op);
+  case ASYNC_WRITE:
+    return try_write(vm, op);
+  case ASYNC_SLEEP:
+    if (now < op->deadline) {
+      return ASYNC_BLOCKED;
+    }
+    op->result.value = get_null(vm);
+    return ASYNC_DONE;
+  }
+  return ASYNC_DONE;
+}
+
+static void complete(EventLoop *loop, AsyncOp *op, AsyncOp *previous) {
+  if (previous) {
+    previous->next = op->next;
+  } else {
+    loop->pending = op->next;
+  }
+  if (loop->pending_tail == op) {
+    loop->pending_tail = previous;
+  }
+  op->next = NULL;
+  op->done = 1;
+  free(op->data);
+  op->data = NULL;
+}
+
+/* ///////////////////////// LOOP ///////////////////////// */
+
+/*
+Gives every pending operation a chance to make progress. An operation behind a blocked one on the same file and in
+the same direction waits its turn. Afterwards the epoll set watches exactly the descriptors that are blocked.
+Returns the earliest sleep deadline still pending (UINT64_MAX if there is none).
+*/
+static uint64_t run_ready(VM *vm, EventLoop *loop) {
+  for (FileHandle *file = vm->open_files; file; file = file->next) {
+    file->async_wanted = 0;
+  }
+
+  uint64_t now = now_ns();
+  uint64_t next_deadline = UINT64_MAX;
+  AsyncOp *previous = NULL;
+  AsyncOp *op = loop->pending;
+  while (op) {
+    AsyncOp *next = op->next;
+    uint32_t direction = op->kind == ASYNC_READ_LINE ? EPOLLIN : op->kind == ASYNC_WRITE ? EPOLLOUT : 0;
+    if (op->file && (op->file->async_wanted & direction)) {
+      previous = op; // an earlier operation on this file is still waiting
+    } else if (try_op(vm, op, now) == ASYNC_DONE) {
+      complete(loop, op, previous);
+    } else {
+      if (op->file) {
+        op->file->async_wanted |= direction;
+      } else if (op->deadline < next_deadline) {
+        next_deadline = op->deadline;
+      }
+      previous = op;
+    }
+    op = next;
+  }
+
+  for (FileHandle *file = vm->open_files; file; file = file->next) {
+    if (file->async_wanted == file->async_events) {
+      continue;
+    }
+    struct epoll_event event = {0};
+    event.events = file->async_wanted;
+    event.data.ptr = file;
+    int operation = !file->async_events ? EPOLL_CTL_ADD : !file->async_wanted ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    if (epoll_ctl(loop->epoll_fd, operation, file->fd, &event) != 0 && operation != EPOLL_CTL_DEL) {
+      printf("Error: Failed to watch file: %s\n", strerror(errno));
+    }
+    file->async_events = file->async_wanted;
+  }
+  return next_deadline;
+}
+
+int async_await(VM *vm, AsyncOp *op) {
+  EventLoop *loop = vm->events;
+  while (!op->done) {
+    uint64_t deadline = run_ready(vm, loop);
+    if (op->done) {
+      break;
+    }
+
+    int timeout = -1;
+    if (deadline != UINT64_MAX) {
+      uint64_t now = now_ns();
+      uint64_t wait = deadline > now ? deadline - now : 0;
+      timeout = (int)((wait + 999999) / 1000000); // round up, waking early would only spin
+    }
+    struct epoll_event events[EVENT_BATCH];
+    if (epoll_wait(loop->epoll_fd, events, EVENT_BATCH, timeout) < 0 && errno != EINTR) {
+      printf("Error: Event loop failed: %s\n", strerror(errno));
+      return -1;
+    }
+  }
+  return op->result.value ? 0 : -1;
+}
+
+/* ///////////////////////// BUILTIN ENTRY POINTS ///////////////////////// */
+
+AsyncOp *async_read_line(VM *vm, FileHandle *file) {
+  AsyncOp *op = new_op(vm, ASYNC_READ_LINE, file);
+  if (op) {
+    run_ready(vm, vm->events);
+  }
+  return op;
+}
+
+AsyncOp *async_write(VM *vm, FileHandle *file, const char *bytes, size_t length) {
+  char *data = malloc(length ? length : 1);
+  if (!data) {
+    printf("Error: Failed to allocate %zu bytes for an async write.\n", length);
+    return NULL;
+  }
+  memcpy(data, bytes, length);
+  AsyncOp *op = new_op(vm, ASYNC_WRITE, file);
+  if (!op) {
+    free(data);
+    return NULL;
+  }
+  op->data = data;
+  op->length = length;
+  run_ready(vm, vm->events);
+  return op;
+}
+
+AsyncOp *async_sleep(VM *vm, int64_t milliseconds) {
+  AsyncOp *op = new_op(vm, ASYNC_SLEEP, NULL);
+  if (op) {
+    op->deadline = now_ns() + (uint64_t)(milliseconds > 0 ? milliseconds : 0) * 1000000u;
+  }
+  return op;
+}
+
+void async_finish_file(VM *vm, FileHandle *file) {
+  EventLoop *loop = vm->events;
+  if (!loop) {
+    return;
+  }
+  AsyncOp *previous = NULL;
+  AsyncOp *op = loop->pending;
+  while (op) {
+    AsyncOp *next = op->next;
+    if (op->kind == ASYNC_READ_LINE && (!file || op->file == file)) {
+      op->result.value = get_null(vm); // nothing more will be read from a closed file
+      complete(loop, op, previous);
+    } else {
+      previous = op;
+    }
+    op = next;
+  }
+  // writes are awaited in order, await keeps servicing everything else meanwhile
+  for (op = loop->pending; op;) {
+    if (op->kind == ASYNC_WRITE && (!file || op->file == file)) {
+      if (async_await(vm, op) != 0 && !op->done) {
+        return; // the loop itself failed
+      }
+      op = loop->pending; // the list changed
+    } else {
+      op = op->next;
+    }
+  }
+}
@@ -0,0 +1,54 @@
+#ifndef EVENT_LOOP_H
+#define EVENT_LOOP_H
+
+#include "builtins.h"
+#include <stdint.h>
+
+/*
+Event loop behind the async builtins (linux, epoll).
+
+Every async builtin queues an AsyncOp and tries it once right away (regular files, which epoll can not watch, are
+always ready). An operation that would block waits in the pending list with its file descriptor registered in the
+epoll set. await(h) runs the loop until h is done: whenever any descriptor becomes ready or a sleep expires, every
+pending operation that can make progress does, so several reads, writes and sleeps overlap their waits.
+Operations on the same file run in the order they were started.
+*/
+
+typedef enum {
+  ASYNC_READ_LINE, // next line of a file, NULL at the end
+  ASYNC_WRITE,     // all bytes of data, resolves to the number of bytes
+  ASYNC_SLEEP,     // resolves to NULL once deadline has passed
+} AsyncKind;
+
+typedef struct AsyncOp {
+  HandleBase base;
+  AsyncKind kind;
+  int done;
+  StackEntry result; // valid once done, result.value is NULL if the operation failed
+  FileHandle *file;
+  char *data; // bytes still to write (a copy, freed once written)
+  size_t length;
+  size_t written;
+  uint64_t deadline; // CLOCK_MONOTONIC nanoseconds
+  struct AsyncOp *next;
+} AsyncOp;
+
+typedef struct EventLoop {
+  int epoll_fd;
+  AsyncOp *pending; // oldest first
+  AsyncOp *pending_tail;
+} EventLoop;
+
+// Start an operation. Returns NULL (after printing an error) if it could not be queued.
+AsyncOp *async_read_line(VM *vm, FileHandle *file);
+AsyncOp *async_write(VM *vm, FileHandle *file, const char *bytes, size_t length);
+AsyncOp *async_sleep(VM *vm, int64_t milliseconds);
+
+// Runs the loop until op is done. Returns 0 on success.
+int async_await(VM *vm, AsyncOp *op);
+
+// Finishes the pending writes of file (or of every file if NULL) and drops its pending reads (they resolve to NULL).
+// Called before files are closed so nothing queued is lost.
+void async_finish_file(VM *vm, FileHandle *file);
+
+#endif
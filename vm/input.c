@@ -0,0 +1,88 @@
+#include "input.h"
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+void input_init(InputReader *in, int fd) {
+  in->fd = fd;
+  in->data = NULL;
+  in->start = 0;
+  in->scanned = 0;
+  in->end = 0;
+  in->capacity = 0;
+  in->eof = 0;
+}
+
+/* Reads more bytes after end, making room first. Returns the number of bytes read, 0 at end of input, -1 on error */
+static long fill(InputReader *in) {
+  if (in->start > 0) { // slide the unfinished line to the front
+    memmove(in->data, in->data + in->start, in->end - in->start);
+    in->end -= in->start;
+    in->start = 0;
+  }
+  if (in->end == in->capacity) { // the unfinished line fills the whole buffer
+    size_t capacity = in->capacity ? in->capacity * 2 : INPUT_BUFFER_DEFAULT;
+    char *data = realloc(in->data, capacity);
+    if (!data) {
+      printf("Error: Failed to grow input buffer to %zu bytes.\n", capacity);
+      return -1;
+    }
+    in->data = data;
+    in->capacity = capacity;
+  }
+
+  if (in->fd == STDIN_FILENO) {
+    fflush(stdout); // prompts have to be visible before blocking on stdin
+  }
+  while (1) {
+    ssize_t count = read(in->fd, in->data + in->end, in->capacity - in->end);
+    if (count < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return -1;
+    }
+    in->end += (size_t)count;
+    return (long)count;
+  }
+}
+
+int input_read_line(InputReader *in, const char **line, size_t *length) {
+  while (1) {
+    char *from = in->data + in->start + in->scanned;
+    char *newline = in->end > in->start ? memchr(from, '\n', in->end - in->start - in->scanned) : NULL;
+    if (newline) {
+      *line = in->data + in->start;
+      *length = (size_t)(newline - *line);
+      in->start += *length + 1;
+      in->scanned = 0;
+      return 1;
+    }
+    in->scanned = in->end - in->start;
+
+    if (in->eof) {
+      if (in->end == in->start) {
+        return 0;
+      }
+      *line = in->data + in->start; // last line without a newline
+      *length = in->end - in->start;
+      in->start = in->end;
+      in->scanned = 0;
+      return 1;
+    }
+    long count = fill(in);
+    if (count < 0) {
+      return -1;
+    }
+    if (count == 0) {
+      in->eof = 1;
+    }
+  }
+}
+
+void input_free(InputReader *in) {
+  free(in->data);
+  input_init(in, in->fd);
+}
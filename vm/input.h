@@ -0,0 +1,35 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stddef.h>
+
+/*
+Buffered line reader used by OP_INPUT.
+
+Input is pulled from a file descriptor with large read() calls and lines are found with memchr, so the bytes are
+copied only once more, into the string object built from the line. A line longer than the buffer grows it, lines
+have no length limit. The partial line left at the end of the buffer is moved to the front before the next read.
+Reading stdin flushes stdout first, only when a read is needed: lines that are already buffered cost no syscall.
+*/
+
+#define INPUT_BUFFER_DEFAULT (64 * 1024)
+
+typedef struct {
+  int fd;
+  char *data;     // allocated on the first read
+  size_t start;   // first byte not handed out yet
+  size_t scanned; // bytes from start already known to have no newline
+  size_t end;     // end of the bytes read so far
+  size_t capacity;
+  int eof;
+} InputReader;
+
+void input_init(InputReader *in, int fd);
+
+// Next line without its '\n', valid until the next call. Returns 1 for a line, 0 at end of input and -1 on errors.
+// The last line does not need a trailing newline.
+int input_read_line(InputReader *in, const char **line, size_t *length);
+
+void input_free(InputReader *in);
+
+#endif
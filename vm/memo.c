@@ -0,0 +1,149 @@
+#include "memo.h"
+#include "vm.h"
+#include <stdio.h>
+#include <string.h>
+
+#define MEMO_SETS (MEMO_CACHE_SIZE / MEMO_WAYS)
+
+MemoCache *init_memo_cache(const char *name, int num_args) {
+  if (num_args > MEMO_MAX_ARGS) {
+    return NULL;
+  }
+
+  MemoCache *cache = calloc(1, sizeof(MemoCache)); // calloc so every entry starts unused
+  if (!cache) {
+    printf("Failed to allocate memory for memo cache.\n");
+    return NULL;
+  }
+  cache->name = strdup(name);
+  cache->num_args = num_args;
+  return cache;
+}
+
+/* splitmix64 finaliser, spreads the argument bits over the whole hash */
+static uint64_t mix64(uint64_t x) {
+  x ^= x >> 30;
+  x *= 0xbf58476d1ce4e5b9ULL;
+  x ^= x >> 27;
+  x *= 0x94d049bb133111ebULL;
+  x ^= x >> 31;
+  return x;
+}
+
+int memo_make_key(MemoCache *cache, StackEntry *args, MemoKey *key) {
+  uint64_t hash = (uint64_t)cache->num_args;
+
+  memset(key, 0, sizeof(MemoKey));
+  for (int i = 0; i < cache->num_args; i++) {
+    if (args[i].entry_type != PRIMITIVE_OBJ || !args[i].value) {
+      return 0;
+    }
+
+    PrimitiveObject *obj = (PrimitiveObject *)args[i].value;
+    MemoArg *arg = &key->args[i];
+    arg->type = obj->type;
+
+    switch (obj->type) {
+    case TYPE_int:
+      arg->bits = ((int_Object *)obj)->value;
+      break;
+    case TYPE_float:
+      memcpy(&arg->bits, &((float_Object *)obj)->value, sizeof(double));
+      break;
+    case TYPE_bool:
+      arg->bits = ((bool_Object *)obj)->value;
+      break;
+    case TYPE_Null:
+      arg->bits = 0;
+      break;
+    default: // strings are not used as keys
+      return 0;
+    }
+
+    hash = mix64(hash ^ ((uint64_t)arg->type << 56) ^ (uint64_t)arg->bits);
+  }
+
+  key->hash = hash;
+  return 1;
+}
+
+static int memo_key_equal(MemoCache *cache, MemoKey *a, MemoKey *b) {
+  if (a->hash != b->hash) {
+    return 0;
+  }
+  for (int i = 0; i < cache->num_args; i++) {
+    if (a->args[i].type != b->args[i].type || a->args[i].bits != b->args[i].bits) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+int memo_lookup(MemoCache *cache, MemoKey *key, StackEntry *result) {
+  MemoEntry *set = &cache->entries[(key->hash % MEMO_SETS) * MEMO_WAYS];
+
+  cache->tick++;
+  for (int i = 0; i < MEMO_WAYS; i++) {
+    if (set[i].used && memo_key_equal(cache, &set[i].key, key)) {
+      set[i].last_used = cache->tick;
+      result->value = set[i].result;
+      result->entry_type = set[i].result_type;
+      cache->hits++;
+      return 1;
+    }
+  }
+  cache->misses++;
+  return 0;
+}
+
+void memo_store(MemoCache *cache, MemoKey *key, StackEntry result) {
+  if (result.entry_type != PRIMITIVE_OBJ || !result.value) {
+    return; // only primitive results are cached
+  }
+
+  MemoEntry *set = &cache->entries[(key->hash % MEMO_SETS) * MEMO_WAYS];
+  MemoEntry *victim = &set[0];
+
+  for (int i = 0; i < MEMO_WAYS; i++) {
+    if (!set[i].used) {
+      victim = &set[i];
+      break;
+    }
+    if (set[i].last_used < victim->last_used) {
+      victim = &set[i];
+    }
+  }
+  if (victim->used) {
+    cache->evictions++;
+  }
+
+  victim->key = *key;
+  victim->result = result.value;
+  victim->result_type = result.entry_type;
+  victim->last_used = ++cache->tick;
+  victim->used = 1;
+}
+
+void print_memo_stats(VM *vm) {
+  printf("Memo stats:\n");
+  if (vm->memoCount == 0) {
+    printf("  no pure functions were memoized\n");
+    return;
+  }
+  for (int i = 0; i < vm->memoCount; i++) {
+    MemoCache *cache = vm->memo_caches[i];
+    uint64_t lookups = cache->hits + cache->misses;
+    double rate = lookups ? 100.0 * (double)cache->hits / (double)lookups : 0.0;
+    printf("  %s: %lu calls, %lu hits, %lu misses (%.1f%% hit rate), %lu evictions, %lu uncacheable\n",
+           cache->name, (unsigned long)(lookups + cache->bypassed), (unsigned long)cache->hits,
+           (unsigned long)cache->misses, rate, (unsigned long)cache->evictions,
+           (unsigned long)cache->bypassed);
+  }
+}
+
+void free_memo_cache(MemoCache *cache) {
+  if (cache) {
+    free(cache->name);
+    free(cache);
+  }
+}
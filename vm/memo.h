@@ -0,0 +1,59 @@
+#ifndef MEMO_H
+#define MEMO_H
+
+#include "vm.h"
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MEMO_MAX_ARGS 4     // functions with more arguments are not memoized
+#define MEMO_CACHE_SIZE 256 // entries per function (must be a multiple of MEMO_WAYS)
+#define MEMO_WAYS 4         // entries per set, the least recently used one is evicted
+
+/* A single primitive argument, compared by type and raw value bits */
+typedef struct {
+  PrimitiveType type;
+  int64_t bits; // int/bool value or the bit pattern of a double (unused for Null)
+} MemoArg;
+
+typedef struct {
+  uint64_t hash;
+  MemoArg args[MEMO_MAX_ARGS];
+} MemoKey;
+
+typedef struct {
+  MemoKey key;
+  void *result;
+  StackEntryType result_type;
+  uint64_t last_used; // tick of the last hit, used for LRU eviction within a set
+  uint8_t used;
+} MemoEntry;
+
+struct MemoCache {
+  char *name; // function name (for -memo-stats)
+  int num_args;
+  uint64_t tick;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t bypassed; // calls whose arguments could not be used as a key
+  uint64_t evictions;
+  MemoEntry entries[MEMO_CACHE_SIZE];
+};
+
+// Create a result cache for a pure function (returns NULL if it takes too many arguments)
+MemoCache *init_memo_cache(const char *name, int num_args);
+
+// Build a key from call arguments. Returns 0 if an argument is not an int, float, bool or NULL.
+int memo_make_key(MemoCache *cache, StackEntry *args, MemoKey *key);
+
+// Look up a key, returns 1 and fills result on a hit
+int memo_lookup(MemoCache *cache, MemoKey *key, StackEntry *result);
+
+// Store the result of a call, evicting the least recently used entry of the set if it is full
+void memo_store(MemoCache *cache, MemoKey *key, StackEntry result);
+
+// Print hit rates of every memoized function
+void print_memo_stats(VM *vm);
+
+void free_memo_cache(MemoCache *cache);
+
+#endif
@@ -0,0 +1,79 @@
+#include "native.h"
+#include "vm.h"
+#include <stdio.h>
+#include <string.h>
+
+#ifdef _WIN32
+#include <windows.h>
+#define module_open(path) ((void *)LoadLibraryA(path))
+#define module_symbol(handle, name) ((void *)GetProcAddress((HMODULE)(handle), name))
+#define module_close(handle) FreeLibrary((HMODULE)(handle))
+#define module_error() "LoadLibrary failed"
+#else
+#include <dlfcn.h>
+#define module_open(path) dlopen(path, RTLD_NOW | RTLD_LOCAL)
+#define module_symbol(handle, name) dlsym(handle, name)
+#define module_close(handle) dlclose(handle)
+#define module_error() dlerror()
+#endif
+
+int register_native(VM *vm, const char *name, int num_args, NativeFn fn) {
+  if (!name || !fn || num_args < 0) {
+    printf("Error: Invalid native function registration.\n");
+    return 1;
+  }
+
+  FunctionEntry *func_entry = malloc(sizeof(FunctionEntry));
+  if (!func_entry) {
+    printf("Error: Failed to allocate memory for function entry.\n");
+    return 1;
+  }
+
+  func_entry->name = strdup(name);
+  func_entry->kind = FUNC_NATIVE;
+  func_entry->native = fn;
+  func_entry->func_body_address = 0;
+  func_entry->num_args = num_args;
+  func_entry->local_count = num_args;
+  func_entry->flags = vm->image ? FUNC_FLAG_RESOLVED : 0; // extern while a script runs: wins over its functions
+  func_entry->memo = NULL;
+
+  hashmap_set(vm->functions, name, func_entry, free);
+  return 0;
+}
+
+int load_native_module(VM *vm, const char *path) {
+  for (int i = 0; i < vm->nativeModuleCount; i++) {
+    if (strcmp(vm->native_module_paths[i], path) == 0) {
+      return 0; // already loaded
+    }
+  }
+
+  if (vm->nativeModuleCount >= MAX_NATIVE_MODULES) {
+    printf("Error: Too many native modules loaded (max %d).\n", MAX_NATIVE_MODULES);
+    return 1;
+  }
+
+  void *handle = module_open(path);
+  if (!handle) {
+    printf("Error: Could not load native module \"%s\": %s\n", path, module_error());
+    return 1;
+  }
+
+  NativeModuleInit init = (NativeModuleInit)module_symbol(handle, RATSNAKE_MODULE_INIT);
+  if (!init) {
+    printf("Error: Native module \"%s\" does not export %s.\n", path, RATSNAKE_MODULE_INIT);
+    module_close(handle);
+    return 1;
+  }
+
+  vm->native_modules[vm->nativeModuleCount] = handle;
+  vm->native_module_paths[vm->nativeModuleCount] = strdup(path);
+  vm->nativeModuleCount++;
+
+  if (init(vm) != 0) {
+    printf("Error: Native module \"%s\" failed to initialise.\n", path);
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef NATIVE_H
+#define NATIVE_H
+
+#include "vm.h"
+
+/*
+Native function interface.
+
+Native functions live in vm->functions next to bytecode functions (tagged FUNC_NATIVE) and are called by OP_CALL
+with their arguments popped from the stack in order. Extension modules are shared libraries that export
+RATSNAKE_MODULE_INIT, which is called once when a script declares `extern fn name(args) from "library";`
+String arguments may be unflattened ropes or views: read their bytes with str_value() rather than ->value, and use
+str_cstr() where a NUL terminated string is needed.
+
+EXAMPLE (kernels.c, built with: gcc -shared -fPIC -I<ratsnake>/vm kernels.c -o libkernels.so):
+
+StackEntry dot2(VM *vm, int argc, StackEntry *args) {
+  int64_t a = ((int_Object *)args[0].value)->value;
+  int64_t b = ((int_Object *)args[1].value)->value;
+  StackEntry result = {new_int(vm, a * a + b * b), PRIMITIVE_OBJ};
+  return result;
+}
+
+int ratsnake_module_init(VM *vm) {
+  return register_native(vm, "dot2", 2, dot2);
+}
+*/
+
+#define RATSNAKE_MODULE_INIT "ratsnake_module_init"
+
+/* Signature of the registration hook exported by extension modules, returns 0 on success */
+typedef int (*NativeModuleInit)(VM *vm);
+
+// Register (or replace) a native function taking num_args arguments. Returns 0 on success.
+int register_native(VM *vm, const char *name, int num_args, NativeFn fn);
+
+// Load a shared library and run its registration hook. Loading the same path twice is a no-op. Returns 0 on success.
+int load_native_module(VM *vm, const char *path);
+
+#endif
@@ -0,0 +1,53 @@
+#include "output.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#ifndef __GLIBC__ // the vm is single threaded, the locking versions only cost time
+#define fwrite_unlocked fwrite
+#define putc_unlocked putc
+#endif
+
+int output_init(OutputBuffer *out, size_t capacity) {
+  out->data = NULL;
+  out->capacity = 0;
+  out->line_buffered = isatty(STDOUT_FILENO);
+  return output_resize(out, capacity);
+}
+
+int output_resize(OutputBuffer *out, size_t capacity) {
+  char *data = NULL;
+  if (capacity > 0) {
+    data = malloc(capacity);
+    if (!data) {
+      printf("Error: Failed to allocate an output buffer of %zu bytes.\n", capacity);
+      return -1;
+    }
+  }
+
+  fflush(stdout);
+  int mode = capacity == 0 ? _IONBF : out->line_buffered ? _IOLBF : _IOFBF;
+  if (setvbuf(stdout, data, mode, capacity) != 0) {
+    free(data);
+    return -1;
+  }
+  free(out->data); // stdio no longer uses it (kept alive until now, stdio flushes at exit)
+  out->data = data;
+  out->capacity = capacity;
+  return 0;
+}
+
+int output_flush(OutputBuffer *out) {
+  (void)out;
+  return fflush(stdout);
+}
+
+void output_write(OutputBuffer *out, const char *bytes, size_t length) {
+  (void)out;
+  fwrite_unlocked(bytes, 1, length, stdout);
+}
+
+void output_end_line(OutputBuffer *out) {
+  (void)out;
+  putc_unlocked('\n', stdout);
+}
@@ -0,0 +1,38 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+#include <stddef.h>
+
+/*
+Buffered stdout used by OP_PRINT.
+
+The vm owns the buffer and installs it as the stdio buffer of stdout, so printed values and the diagnostics printf'd
+by the vm (or by native code) stay in order. Values are formatted without allocating and copied in with the
+unlocked stdio calls. stdout is flushed when the buffer is full, after every line if it is a terminal, before
+reading input and when the vm stops. A capacity of 0 writes every print immediately.
+*/
+
+#define OUTPUT_BUFFER_DEFAULT (64 * 1024) // -obuf=SIZE changes it
+
+typedef struct {
+  char *data;
+  size_t capacity;
+  int line_buffered; // flush after every line (stdout is a tty)
+} OutputBuffer;
+
+// Installs a buffer of capacity bytes as the stdout buffer. Returns 0 on success.
+int output_init(OutputBuffer *out, size_t capacity);
+
+// Flushes and changes the capacity (0 = unbuffered). Returns 0 on success, the old buffer is kept on failure.
+int output_resize(OutputBuffer *out, size_t capacity);
+
+// Writes everything buffered so far. Returns 0 on success.
+int output_flush(OutputBuffer *out);
+
+// Appends length bytes.
+void output_write(OutputBuffer *out, const char *bytes, size_t length);
+
+// Ends a printed line (stdio flushes it right away when line buffered).
+void output_end_line(OutputBuffer *out);
+
+#endif
@@ -14,6 +14,7 @@ StackFrame *init_stack_frame(VM *vm, uint64_t *return_address, size_t local_coun
   frame->return_address = return_address;
   frame->local_count = local_count;
   frame->parent_base_pointer = vm->stack.base_pointer;
+  frame->memo = NULL;
   memset(frame->locals, 0, sizeof(frame->locals));
 
   return frame;
@@ -88,6 +89,9 @@ void return_from_frame(VM *vm) {
   uint64_t *return_address = frame->return_address;
   // Pop the function return value
   StackEntry returnVal = pop(vm);
+  if (frame->memo) {
+    memo_store(frame->memo, &frame->memo_key, returnVal);
+  }
   // Reset stack top to base pointer
   vm->stack.stack_top = vm->stack.base_pointer;
   // Overwrite the frame entry to return value
@@ -3,6 +3,7 @@
 
 #include "../hashmap/hashmap.h"
 #include "vm.h"
+#include "memo.h"
 #include <stdint.h>
 #include <stdlib.h>
 
@@ -26,6 +27,9 @@ typedef struct StackFrame {
    using local count.
    * */
   size_t local_count; // Number of local variables
+
+  MemoCache *memo;  // cache the return value is stored in (NULL if the call is not memoized)
+  MemoKey memo_key; // arguments of the call, key for memo
 } StackFrame;
 
 // Initialize a new stack frame
@@ -1,9 +1,17 @@
 #include "vm.h"
 #include "../hashmap/hashmap.h"
 #include "stackframe.h"
+#include "memo.h"
+#include "native.h"
+#include "builtins.h"
+#include "../CorePrimitives/number_parse.h"
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 /* ///////////////////////// VM ///////////////////////// */
 /* Initialize VM */
@@ -21,11 +29,15 @@ VM *initVM() {
   // initialise globals
   vm->globals = init_hashmap(MAX_GLOBALS);
   vm->functions = init_hashmap(MAX_FUNCTIONS);
+  vm->strings = init_hashmap(MAX_CONSTANTS); // intern table of string literals
 
   // initialise counters
   vm->constantCount = 0;
   /*vm->functionCount = 0;*/
   vm->objectCount = 0;
+  vm->memoCount = 0;
+  vm->memo_stats = 0;
+  vm->nativeModuleCount = 0;
 
   // create clean tables
   memset(vm->objects, 0, sizeof(vm->objects)); // Zero out object table
@@ -42,11 +54,34 @@ VM *initVM() {
       (PrimitiveObject *)new_bool(vm, 0); // index 1 (false)
   vm->constants[vm->constantCount++] =
       (PrimitiveObject *)new_bool(vm, 1); // index 2 (true)
-  for (int i = -510; i <= 510; i++) {
+  for (int i = -SMALL_INT_MAX; i <= SMALL_INT_MAX; i++) {
     vm->constants[vm->constantCount++] = (PrimitiveObject *)new_int(vm, i);
   }
 
-  // initialise bytecode instruction pointer
+  // builtin functions live in the function table next to the script's functions
+  if (register_builtins(vm) != 0) {
+    printf("Failed to register builtin functions.\n");
+  }
+
+  // initialise output buffer
+  if (output_init(&vm->output, OUTPUT_BUFFER_DEFAULT) != 0) {
+    output_init(&vm->output, 0); // unbuffered still works
+  }
+  input_init(&vm->input, 0);
+  vm->open_files = NULL;
+  vm->events = NULL;
+  vm->records.enabled = 0;
+  vm->records.stage = RECORD_BEGIN;
+  vm->records.on_line = NULL;
+
+  // initialise bytecode image and instruction pointer
+  vm->image = NULL;
+  vm->image_size = 0;
+  vm->image_mapped = 0;
+  vm->directory = NULL;
+  vm->function_count = 0;
+  vm->pool = NULL;
+  vm->pool_count = 0;
   vm->bytecode_ip = NULL;
 
   return vm;
@@ -131,7 +166,7 @@ int is_truthy(PrimitiveObject *obj) {
 
   case TYPE_str: // truthy so long as it is not an empty string
     // printf("string value is: %s\n", ((str_Object *)obj)->value[0]);
-    return ((str_Object *)obj)->value[0] != '\0' ? 1 : 0;
+    return ((str_Object *)obj)->length != 0 ? 1 : 0;
 
   case TYPE_Null: // always false
     return 0;
@@ -142,6 +177,31 @@ int is_truthy(PrimitiveObject *obj) {
   }
 }
 
+/* Truthiness of a stack entry: handles (ADVANCED_OBJ, e.g. an open file) are always true */
+static int entry_truthy(StackEntry entry) {
+  return entry.entry_type == ADVANCED_OBJ ? 1 : is_truthy((PrimitiveObject *)entry.value);
+}
+
+/*
+Resolves a slice bound the way python does: NULL means the start/end of the string, negative values count from
+the end and anything out of range is clamped. Returns 0 if the bound is not an int or NULL.
+*/
+static int slice_bound(PrimitiveObject *obj, size_t length, size_t fallback, size_t *bound) {
+  if (obj->type == TYPE_Null) {
+    *bound = fallback;
+    return 1;
+  }
+  if (obj->type != TYPE_int) {
+    return 0;
+  }
+  int64_t value = ((int_Object *)obj)->value;
+  if (value < 0) {
+    value += (int64_t)length;
+  }
+  *bound = value < 0 ? 0 : (uint64_t)value > length ? length : (size_t)value;
+  return 1;
+}
+
 /* get constant function definition */
 PrimitiveObject *get_constant(VM *vm, OpCode opcode, int64_t value) {
   switch (opcode) {
@@ -152,8 +212,8 @@ PrimitiveObject *get_constant(VM *vm, OpCode opcode, int64_t value) {
     return vm->constants[value ? 2 : 1];
 
   case INT:
-    if (value >= -510 && value <= 510) {
-      return vm->constants[3 + value + 510];
+    if (value >= -SMALL_INT_MAX && value <= SMALL_INT_MAX) {
+      return vm->constants[3 + value + SMALL_INT_MAX];
     } else {
       return NULL; // Not in constant pool
     }
@@ -164,165 +224,393 @@ PrimitiveObject *get_constant(VM *vm, OpCode opcode, int64_t value) {
   }
 }
 
-/* Function to load function definitions from bytecode */
-void load_functions(VM *vm, uint8_t *bytecode, size_t func_section_start,
-                    size_t func_section_end) {
+/* Creates the function entry of a directory entry and adds it to the function table */
+static FunctionEntry *bind_function(VM *vm, const FunctionDirEntry *dir) {
+  const uint8_t *name = vm->image + dir->name_offset;
+  if ((size_t)dir->body_offset + dir->body_length > vm->image_size || dir->body_length == 0 ||
+      vm->image[dir->body_offset + dir->body_length - 1] != OP_ENDFUNC) {
+    printf("Error: Malformed function directory entry for '%.*s'.\n", id_length(name), id_name(name));
+    return NULL;
+  }
+
+  FunctionEntry *func_entry = malloc(sizeof(FunctionEntry));
+  char *func_name = malloc(id_length(name) + 1);
+  if (!func_entry || !func_name) {
+    printf("Error: Failed to allocate memory for function entry.\n");
+    free(func_entry);
+    free(func_name);
+    return NULL;
+  }
+  memcpy(func_name, id_name(name), id_length(name));
+  func_name[id_length(name)] = '\0';
+
+  func_entry->name = func_name;
+  func_entry->kind = FUNC_BYTECODE;
+  func_entry->native = NULL;
+  func_entry->func_body_address = (size_t)(vm->image + dir->body_offset);
+  func_entry->num_args = dir->num_args;
+  func_entry->local_count = dir->num_vars;
+  func_entry->flags = dir->flags;
+  func_entry->memo = NULL;
+  if ((dir->flags & FUNC_FLAG_PURE) && vm->memoCount < MAX_FUNCTIONS) {
+    func_entry->memo = init_memo_cache(func_name, dir->num_args);
+    if (func_entry->memo) {
+      vm->memo_caches[vm->memoCount++] = func_entry->memo;
+    }
+  }
 
-  uint8_t *function_section = bytecode + func_section_start;
-  uint8_t *section_end = bytecode + func_section_end;
+  hashmap_set_prehashed(vm->functions, id_name(name), id_length(name), id_hash(name), func_entry, free);
+  return func_entry;
+}
 
-  // No functions declared
-  if (section_end - function_section == 0) {
-    return;
+/*
+Finds the function called name. Script functions are bound from the directory on their first call, so loading costs
+nothing per function and functions that are never called are never decoded. A script function replaces a builtin of
+the same name (natives registered while the script runs, by extern, replace script functions instead).
+*/
+static FunctionEntry *find_function(VM *vm, const char *name, size_t length, uint64_t hash) {
+  FunctionEntry *func = (FunctionEntry *)hashmap_get_prehashed(vm->functions, name, length, hash);
+  if (func && (func->kind == FUNC_BYTECODE || (func->flags & FUNC_FLAG_RESOLVED))) {
+    return func;
   }
 
-//   printf("Reading from function section offset: %ld\n", function_section - bytecode);
-//   printf("First byte in section: 0x%02X\n", *function_section);
-  while (function_section < section_end) {
-    if (*function_section != OP_FUNCDEF) {
-        printf("Error: Expected function definition flag.\n");
-        printf("Reading from function section offset: %ld\n", function_section - bytecode);
-        printf("First byte in section: 0x%02X\n", *function_section);
-        exit(EXIT_FAILURE);
+  size_t low = 0;
+  size_t high = vm->function_count;
+  while (low < high) {
+    size_t mid = low + (high - low) / 2;
+    int order = id_compare(vm->image + vm->directory[mid].name_offset, name, length);
+    if (order == 0) {
+      return bind_function(vm, &vm->directory[mid]);
     }
-    function_section++; // Move past OP_FUNCDEF byte
-    
-    // Read num_args (2 bytes)
-    uint16_t num_args;
-    memcpy(&num_args, function_section, sizeof(uint16_t));
-    function_section += sizeof(uint16_t);
-
-    // Read num_var (aka local_count) (2 bytes)
-    uint16_t local_count;
-    memcpy(&local_count, function_section, sizeof(uint16_t));
-    function_section += sizeof(uint16_t);
-
-    // Read function ID opcode
-    if (*function_section != ID) {
-      printf("Error: Expected ID opcode for function name.\n");
-      return;
-    }
-    function_section++; // Move past ID opcode
-
-    // Read function name length (2 bytes)
-    uint16_t name_length;
-    memcpy(&name_length, function_section, sizeof(uint16_t));
-    function_section += sizeof(uint16_t);
-
-    // Read function name
-    char *func_name = malloc(name_length + 1);
-    memcpy(func_name, function_section, name_length);
-    func_name[name_length] = '\0'; // Null terminate
-    // printf("loading function: %s\n",func_name);
-    function_section += name_length;
-
-    // Create function entry
-    FunctionEntry *func_entry = malloc(sizeof(FunctionEntry));
-    if (!func_entry) {
-      printf("Error: Failed to allocate memory for function entry.\n");
-      free(func_name);
-      return;
+    if (order < 0) {
+      low = mid + 1;
+    } else {
+      high = mid;
     }
+  }
+
+  if (func) {
+    func->flags |= FUNC_FLAG_RESOLVED; // a builtin the script does not redefine
+  }
+  return func;
+}
 
-    func_entry->name = strdup(func_name);
-    func_entry->num_args = num_args;
-    func_entry->local_count = local_count;
+/* Pushes a stack frame for a bytecode function and jumps to its body, OP_RETURN continues at return_address */
+static void enter_function(VM *vm, FunctionEntry *func, StackEntry *args, uint64_t *return_address,
+                           MemoKey *memo_key) {
+  // Create a new stack frame
+  StackFrame *frame = init_stack_frame(vm, return_address, func->local_count);
+  if (!frame) {
+    printf("Error: Failed to create stack frame for function call.\n");
+    return;
+  }
 
-    // Store the current ip (start of function body)
-    func_entry->func_body_address = (size_t)function_section;
+  // Save current stack position as the new base pointer
+  size_t new_base_pointer = vm->stack.stack_top;
 
-    // Add to function table
-    hashmap_set(vm->functions, func_name, func_entry, free);
+  if (memo_key) {
+    frame->memo = func->memo;
+    frame->memo_key = *memo_key;
+  }
 
-    // Free the temporary function name
-    free(func_name);
+  // Push the frame onto the stack
+  push(vm, frame, FUNCTION_FRAME);
+
+  // Update the base pointer to the new stack frame
+  vm->stack.base_pointer = new_base_pointer;
+
+  // Set the arguments as local variables in the stack frame.
+  for (int i = 0; i < func->num_args; i++) {
+    set_local(vm, i, args[i]);
+  }
+
+  // Jump to function body
+  vm->bytecode_ip = (uint64_t *)func->func_body_address;
+}
+
+/* ///////////////////////// RECORD MODE ///////////////////////// */
+
+/* Hooks return here: their result is dropped and OP_HALT asks next_record_call for the next one */
+static const uint8_t record_return[] = {OP_POP, OP_HALT};
 
-    uint8_t *function_end = function_section;
+static FunctionEntry *find_hook(VM *vm, const char *name, int num_args) {
+  FunctionEntry *func = find_function(vm, name, strlen(name), hashmap_hash(name, strlen(name)));
+  if (func && (func->kind != FUNC_BYTECODE || func->num_args != num_args)) {
+    printf("Error: %s must be a function taking %d argument%s for -n.\n", name, num_args, num_args == 1 ? "" : "s");
+    return NULL;
+  }
+  return func;
+}
 
-    while (function_end < section_end) {
-      uint8_t opcode = *function_end;
+/*
+Called by OP_HALT in record mode. Calls the next hook (begin, on_line for the next line of stdin, end) and returns 1,
+or returns 0 when everything has run and -1 on errors.
+*/
+static int next_record_call(VM *vm) {
+  RecordMode *records = &vm->records;
+  StackEntry args[1];
+  FunctionEntry *func = NULL;
+
+  while (!func) {
+    switch (records->stage) {
+    case RECORD_BEGIN:
+      records->on_line = find_hook(vm, RECORD_LINE_FN, 1);
+      if (!records->on_line) {
+        printf("Error: -n needs a function %s(line).\n", RECORD_LINE_FN);
+        return -1;
+      }
+      func = find_hook(vm, RECORD_BEGIN_FN, 0);
+      records->stage = RECORD_LINES;
+      break;
 
-      if (opcode == OP_ENDFUNC) {
-        function_end++; // include the OP_ENDFUNC in the body
+    case RECORD_LINES: {
+      const char *line;
+      size_t length;
+      int status = input_read_line(&vm->input, &line, &length);
+      if (status < 0) {
+        printf("Error: Failed to read input.\n");
+        return -1;
+      }
+      if (status == 0) {
+        records->stage = RECORD_END;
         break;
       }
+      args[0].value = new_str_len(line, length);
+      args[0].entry_type = PRIMITIVE_OBJ;
+      func = records->on_line;
+      break;
+    }
 
-      function_end++; // move past opcode
+    case RECORD_END:
+      func = find_hook(vm, RECORD_END_FN, 0);
+      records->stage = RECORD_DONE;
+      break;
 
-      // this switch statement is here to ensure we don't accidentally read the argument bytes as opcodes
-      switch (opcode) {
-        case INT:
-        case FLOAT:
-          function_end += 8; break;
+    case RECORD_DONE:
+      return 0;
+    }
+  }
 
-        case BOOL:
-          function_end += 1; break;
+  enter_function(vm, func, args, (uint64_t *)record_return, NULL);
+  return 1;
+}
 
-        case STR: {
-          uint32_t len;
-          memcpy(&len, function_end, 4);
-          function_end += 4 + len;
-          break;
-        }
+/* ///////////////////////// LOADING ///////////////////////// */
+
+uint64_t bytecode_checksum(const uint8_t *bytes, size_t length) {
+  // FNV-1a over 8 byte words (then the tail bytes), with a final avalanche
+  uint64_t h = 0xcbf29ce484222325ull;
+  size_t i = 0;
+  for (; i + 8 <= length; i += 8) {
+    uint64_t word;
+    memcpy(&word, bytes + i, 8);
+    h = (h ^ word) * 0x100000001b3ull;
+    h ^= h >> 29;
+  }
+  for (; i < length; i++) {
+    h = (h ^ bytes[i]) * 0x100000001b3ull;
+  }
+  h ^= h >> 32;
+  h *= 0xd6e8feb86659fd93ull;
+  return h ^ (h >> 32);
+}
 
-        case LOCAL:
-            function_end += 2;
-            break;
+/*
+Maps the binary read-only (the pages are shared with the page cache, nothing is copied). Files that can not be
+mapped are read into memory instead. Returns 0 on success.
+*/
+static int load_bytecode(VM *vm, const char *bytecode_file) {
+  int fd = open(bytecode_file, O_RDONLY | O_CLOEXEC);
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) != 0) {
+    printf("Error: Could not open bytecode file %s\n", bytecode_file);
+    if (fd >= 0) {
+      close(fd);
+    }
+    return -1;
+  }
+  size_t size = (size_t)st.st_size;
+
+#ifdef MAP_POPULATE
+  int map_flags = MAP_PRIVATE | MAP_POPULATE; // every page is read by the checksum anyway, fault them in at once
+#else
+  int map_flags = MAP_PRIVATE;
+#endif
+  void *mapping = size ? mmap(NULL, size, PROT_READ, map_flags, fd, 0) : MAP_FAILED;
+  if (mapping != MAP_FAILED) {
+    vm->image = mapping;
+    vm->image_mapped = 1;
+  } else {
+    uint8_t *bytes = malloc(size ? size : 1);
+    size_t done = 0;
+    while (bytes && done < size) {
+      ssize_t count = read(fd, bytes + done, size - done);
+      if (count <= 0) {
+        break;
+      }
+      done += (size_t)count;
+    }
+    if (!bytes || done < size) {
+      printf("Error: Failed to read bytecode file %s\n", bytecode_file);
+      free(bytes);
+      close(fd);
+      return -1;
+    }
+    vm->image = bytes;
+    vm->image_mapped = 0;
+  }
+  close(fd);
+  vm->image_size = size;
+  return 0;
+}
 
-        case ID: {
-          uint16_t len;
-          memcpy(&len, function_end, 2);
-          function_end += 2 + len;
-          break;
-        }
+static void unload_bytecode(VM *vm) {
+  if (vm->image_mapped) {
+    munmap((void *)vm->image, vm->image_size);
+  } else {
+    free((void *)vm->image);
+  }
+  vm->image = NULL;
+  vm->image_size = 0;
+  vm->directory = NULL;
+  vm->function_count = 0;
+  free(vm->pool); // the objects stay alive, only the table goes
+  vm->pool = NULL;
+  vm->pool_count = 0;
+}
 
-        case OP_JMP:
-        case OP_JMPIF:
-          function_end += 4; break;
+/* Checks that the image was written by a compatible compile_ir and is intact. Returns 0 if it can be run. */
+static int validate_bytecode(VM *vm, const char *bytecode_file, BytecodeHeader *header) {
+  if (vm->image_size < sizeof(BytecodeHeader)) {
+    printf("Error: %s is not a ratsnake binary.\n", bytecode_file);
+    return -1;
+  }
+  memcpy(header, vm->image, sizeof(BytecodeHeader));
+  if (header->version != BYTECODE_VERSION) {
+    printf("Error: %s has bytecode version %u, this vm runs version %u.\n", bytecode_file, header->version,
+           BYTECODE_VERSION);
+    return -1;
+  }
+  if (header->flags & ~(uint32_t)BYTECODE_FLAG_COMPACT) {
+    printf("Error: %s uses unsupported bytecode flags 0x%x.\n", bytecode_file, header->flags);
+    return -1;
+  }
+  if (header->execution_section_start > vm->image_size || header->func_section_start > header->func_section_end ||
+      header->func_section_end > vm->image_size || header->directory_start % sizeof(uint64_t) != 0 ||
+      header->directory_start > vm->image_size ||
+      header->function_count > (vm->image_size - header->directory_start) / sizeof(FunctionDirEntry) ||
+      header->pool_start > vm->image_size ||
+      header->checksum != bytecode_checksum(vm->image + sizeof(BytecodeHeader),
+                                            vm->image_size - sizeof(BytecodeHeader))) {
+    printf("Error: %s is corrupted (checksum mismatch).\n", bytecode_file);
+    return -1;
+  }
+  // The ID operands carry hashes computed by compile_ir, which are only usable with the same hash seed
+  if (header->hash_check != hashmap_hash(HASH_CHECK_KEY, strlen(HASH_CHECK_KEY))) {
+    printf("Error: %s was compiled with a different hash seed.\n", bytecode_file);
+    return -1;
+  }
+  return 0;
+}
 
-        // any other opcodes are single byte
-        default:
-          break;
+/*
+Creates every constant of the pool once, before anything runs: OP_CONST pushes them without allocating. Entries are
+INT, FLOAT and STR instructions in the standard encoding. Strings are interned (short ones) or views into the image.
+*/
+static int load_constant_pool(VM *vm, const char *bytecode_file, const BytecodeHeader *header) {
+  vm->pool = malloc((header->pool_count ? header->pool_count : 1) * sizeof(PrimitiveObject *));
+  if (!vm->pool) {
+    printf("Error: Failed to allocate the constant pool of %s.\n", bytecode_file);
+    return -1;
+  }
+
+  const uint8_t *p = vm->image + header->pool_start;
+  const uint8_t *end = vm->image + vm->image_size;
+  for (size_t i = 0; i < header->pool_count; i++) {
+    PrimitiveObject *constant = NULL;
+    size_t size = 0;
+    if (p < end && (*p == INT || *p == FLOAT) && (size_t)(end - p) >= 1 + sizeof(int64_t)) {
+      size = 1 + sizeof(int64_t);
+      if (*p == INT) {
+        int64_t value;
+        memcpy(&value, p + 1, sizeof(int64_t));
+        constant = (PrimitiveObject *)new_int(vm, value);
+      } else {
+        double value;
+        memcpy(&value, p + 1, sizeof(double));
+        constant = (PrimitiveObject *)new_float(value);
       }
+    } else if (p < end && *p == STR && (size_t)(end - p) >= 1 + sizeof(uint32_t)) {
+      uint32_t length;
+      memcpy(&length, p + 1, sizeof(uint32_t));
+      size = 1 + sizeof(uint32_t) + length;
+      if (size > (size_t)(end - p)) {
+        size = 0;
+      } else {
+        const char *bytes = (const char *)p + 1 + sizeof(uint32_t);
+        constant = (PrimitiveObject *)(length < STR_VIEW_MIN ? intern_str(vm, bytes, length) : view_str(bytes, length));
+      }
+    }
+    if (size == 0) {
+      printf("Error: %s has a malformed constant pool.\n", bytecode_file);
+      return -1;
     }
-    function_section = function_end;
+    if (!constant) {
+      printf("Error: Failed to create constant %zu of %s.\n", i, bytecode_file);
+      return -1;
+    }
+    vm->pool[i] = constant;
+    vm->pool_count = i + 1;
+    p += size;
   }
+  return 0;
 }
 
-/* runs the vm */
-void run(VM *vm, const char *bytecode_file) {
-  FILE *file = fopen(bytecode_file, "rb");
-  if (!file) {
-    printf("Error: Could not open bytecode file %s\n", bytecode_file);
-    return;
+/* Operands of the compact encoding (BYTECODE_FLAG_COMPACT): unsigned LEB128, signed values zigzag encoded */
+static inline uint64_t read_uleb(uint64_t **ip) {
+  const uint8_t *p = (const uint8_t *)*ip;
+  uint64_t value = *p & 0x7f;
+  for (unsigned shift = 7; *p++ & 0x80; shift += 7) {
+    value |= (uint64_t)(*p & 0x7f) << shift;
   }
+  *ip = (uint64_t *)p;
+  return value;
+}
+
+static inline int64_t read_zigzag(uint64_t **ip) {
+  uint64_t value = read_uleb(ip);
+  return (int64_t)(value >> 1) ^ -(int64_t)(value & 1);
+}
+
+static void execute(VM *vm, const char *bytecode_file);
 
-  // Read file contents into bytecode memory
-  fseek(file, 0, SEEK_END);
-  long file_size = ftell(file);
-  rewind(file);
+/* runs the vm */
+void run(VM *vm, const char *bytecode_file) {
+  execute(vm, bytecode_file);
+  close_files(vm);
+  output_flush(&vm->output); // error exits return without flushing
+}
 
-  uint8_t *bytecode = malloc(file_size);
-  if (!bytecode) {
-    printf("Error: Failed to allocate memory for bytecode.\n");
-    fclose(file);
+static void execute(VM *vm, const char *bytecode_file) {
+  if (load_bytecode(vm, bytecode_file) != 0) {
     return;
   }
 
-  fread(bytecode, 1, file_size, file);
-  fclose(file);
-
-  vm->bytecode_ip = (uint64_t *)bytecode; // Cast to match existing struct, but
-                                          // must careful with byte addressing
-
   // Read header (64 bytes)
   BytecodeHeader header;
-  memcpy(&header, bytecode, sizeof(BytecodeHeader));
-
-  /*printf("just checking if header has been read\n");*/
+  if (validate_bytecode(vm, bytecode_file, &header) != 0) {
+    unload_bytecode(vm);
+    return;
+  }
 
-  load_functions(vm, bytecode, header.func_section_start,
-                 header.func_section_end);
+  uint8_t *bytecode = (uint8_t *)vm->image; // read-only, only ever read through
+  vm->directory = (const FunctionDirEntry *)(bytecode + header.directory_start);
+  vm->function_count = header.function_count;
+  if (load_constant_pool(vm, bytecode_file, &header) != 0) {
+    unload_bytecode(vm);
+    return;
+  }
+  const int compact = (header.flags & BYTECODE_FLAG_COMPACT) != 0; // operand encoding of INT, OP_CONST, LOCAL, jumps
 
   // Set instruction pointer to start of executable code section
   vm->bytecode_ip = (uint64_t *)(bytecode + header.execution_section_start);
@@ -336,18 +624,36 @@ void run(VM *vm, const char *bytecode_file) {
 
     switch (instruction) {
     case OP_HALT:
+      if (vm->records.enabled) {
+        int status = next_record_call(vm);
+        if (status > 0) {
+          break; // a hook is running now
+        }
+        if (status < 0) {
+          unload_bytecode(vm);
+          return;
+        }
+      }
+      output_flush(&vm->output);
       printf("VM halted.\n");
-      free(bytecode);
+      if (vm->memo_stats) {
+        print_memo_stats(vm);
+      }
+      unload_bytecode(vm);
       return;
 
-    case INT: { // [1 byte opcode][8 byte int64]
+    case INT: { // [1 byte opcode][8 byte int64] (compact: [zigzag LEB128])
       int64_t value;
     //   PrimitiveObject *int_to_push;
 
-      memcpy(&value, vm->bytecode_ip,
-             sizeof(int64_t)); // Copy raw bytes into value
-      vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                                     sizeof(int64_t)); // Move past 8 bytes
+      if (compact) {
+        value = read_zigzag(&vm->bytecode_ip);
+      } else {
+        memcpy(&value, vm->bytecode_ip,
+               sizeof(int64_t)); // Copy raw bytes into value
+        vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip +
+                                       sizeof(int64_t)); // Move past 8 bytes
+      }
     //   int_to_push = get_constant(vm, INT, value);
     //   if (!int_to_push)
     //     int_to_push = (PrimitiveObject *)new_int(vm, value);
@@ -355,13 +661,27 @@ void run(VM *vm, const char *bytecode_file) {
       break;
     }
 
-    case FLOAT: { // [1 byte opcode][8 byte double]
-      double value;
-      memcpy(&value, vm->bytecode_ip,
-             sizeof(double)); // Copy raw bytes into value
-      vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                                     sizeof(double)); // Move past 8 bytes
-      push(vm, new_float(value), PRIMITIVE_OBJ);
+    case INT8: { // [1 byte opcode][1 byte int8]
+      int8_t value = *(int8_t *)vm->bytecode_ip;
+      vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip + 1);
+      push(vm, new_int(vm, value), PRIMITIVE_OBJ);
+      break;
+    }
+
+    case OP_CONST: { // [1 byte opcode][4 byte pool index] (compact: [LEB128 index])
+      uint32_t index;
+      if (compact) {
+        index = (uint32_t)read_uleb(&vm->bytecode_ip);
+      } else {
+        memcpy(&index, vm->bytecode_ip, sizeof(uint32_t));
+        vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip + sizeof(uint32_t));
+      }
+      if (index >= vm->pool_count) {
+        printf("Error: constant index %u out of range (pool has %zu entries).\n", index, vm->pool_count);
+        unload_bytecode(vm);
+        return;
+      }
+      push(vm, vm->pool[index], PRIMITIVE_OBJ);
       break;
     }
 
@@ -375,46 +695,13 @@ void run(VM *vm, const char *bytecode_file) {
       break;
     }
 
-    case STR: { // [1 byte opcode][4 byte length][ length number of bytes]
-      uint32_t length;
-      memcpy(&length, vm->bytecode_ip,
-             sizeof(uint32_t)); // Read 4 bytes as string length
-      vm->bytecode_ip =
-          (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                       sizeof(uint32_t)); // Move past length field
-      // if (length == 0) {
-      //   printf("string length: %d\n", length);
-      // }
-      char *str_value = malloc(length + 1);
-      memcpy(str_value, vm->bytecode_ip, length); // Copy string data
-      str_value[length] = '\0';                   // Null-terminate
-
-      vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                                     length); // Move past string bytes
-
-      push(vm, new_str(str_value), PRIMITIVE_OBJ);
-      free(str_value); // Free our temp variable
-      break;
-    }
+    case ID: { // [1 byte opcode][2 byte ID length][8 byte hash][ ID length number of bytes]
+        uint8_t *identifier = (uint8_t *)vm->bytecode_ip; // the operand is used in place (see id_length/id_hash/id_name)
 
-    case ID: { // [1 byte opcode][2 byte ID length][ ID length number of bytes]
-        uint16_t length;
-        memcpy(&length, vm->bytecode_ip,
-                sizeof(uint16_t)); // Read 2 bytes for ID length
-        vm->bytecode_ip =
-            (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                        sizeof(uint16_t)); // Move past length field
+        vm->bytecode_ip = (uint64_t *)(identifier + sizeof(uint16_t) + sizeof(uint64_t) +
+                                        id_length(identifier)); // Move past length, hash and ID bytes
 
-        char *identifier =
-            malloc(length + 1); // we malloced here so we must free when we hit
-                                // OP_GET_GLOBAL and OP_SET_GLOBAL
-        memcpy(identifier, vm->bytecode_ip, length); // Copy ID string
-        identifier[length] = '\0';                   // Null-terminate
-
-        vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                                        length); // Move past ID bytes
-
-        push(vm, identifier, IDENTIFIER); // Push identifier as raw string
+        push(vm, identifier, IDENTIFIER);
         break;
     }
 
@@ -637,21 +924,21 @@ void run(VM *vm, const char *bytecode_file) {
     case OP_LOGICAL_AND:
       StackEntry condition_b = pop(vm);
       StackEntry condition_a = pop(vm);
-      int result = is_truthy((PrimitiveObject *)condition_a.value) && is_truthy((PrimitiveObject *)condition_b.value);
+      int result = entry_truthy(condition_a) && entry_truthy(condition_b);
       push(vm, get_constant(vm, BOOL, result), PRIMITIVE_OBJ);
       break;
 
     case OP_LOGICAL_OR: {
       StackEntry condition_b = pop(vm);
       StackEntry condition_a = pop(vm);
-      int result = is_truthy((PrimitiveObject *)condition_a.value) || is_truthy((PrimitiveObject *)condition_b.value);
+      int result = entry_truthy(condition_a) || entry_truthy(condition_b);
       push(vm, get_constant(vm, BOOL, result), PRIMITIVE_OBJ);
       break;
     }
 
     case OP_LOGICAL_NOT: {
       StackEntry a = pop(vm);
-      int result = !is_truthy((PrimitiveObject *)a.value);
+      int result = !entry_truthy(a);
       push(vm, get_constant(vm, BOOL, result), PRIMITIVE_OBJ);
       break;
     }
@@ -686,9 +973,8 @@ void run(VM *vm, const char *bytecode_file) {
                 parsed = ((bool_Object *)obj)->value;
                 break;
             case TYPE_str: {
-                char *end;
-                parsed = strtoll(((str_Object *)obj)->value, &end, 10);
-                if (*end != '\0') {
+                str_Object *str = (str_Object *)obj;
+                if (!parse_int64(str_cstr(str), str->length, &parsed)) {
                     printf("Error: Invalid characters in string during int parse.\n");
                     return;
                 }
@@ -718,9 +1004,8 @@ void run(VM *vm, const char *bytecode_file) {
                 parsed = (double)((bool_Object *)obj)->value;
                 break;
             case TYPE_str: {
-                char *end;
-                parsed = strtod(((str_Object *)obj)->value, &end);
-                if (*end != '\0') {
+                str_Object *str = (str_Object *)obj;
+                if (!parse_double(str_cstr(str), str->length, &parsed)) {
                     printf("Error: Invalid characters in string during float parse.\n");
                     return;
                 }
@@ -749,12 +1034,15 @@ void run(VM *vm, const char *bytecode_file) {
               return;
               break;
           }
+
+          if (obj->type == TYPE_str) { // strings are immutable, no copy needed
+              push(vm, obj, PRIMITIVE_OBJ);
+              break;
+          }
       
-          char *stringified = obj->__str__(obj);  
-      
-          push(vm, new_str(stringified), PRIMITIVE_OBJ);
-      
-          free(stringified);  
+          char text[PRIMITIVE_FORMAT_MAX];
+          size_t length = format_primitive(obj, text); // no intermediate __str__ copy
+          push(vm, new_str_len(text, length), PRIMITIVE_OBJ);
           break;
       }
       }
@@ -765,13 +1053,17 @@ void run(VM *vm, const char *bytecode_file) {
         StackEntry value = pop(vm);
         if (value.entry_type == PRIMITIVE_OBJ) {
             PrimitiveObject* obj = (PrimitiveObject*) value.value;
-            if (obj->__str__) { // for primitives implemented this should never be NULL, might even cause issues if str is "" But will keep for safety
-                char* repr = obj->__str__(obj);
-                printf("%s\n", repr);
-                free(repr);  // since we allocated memory to the representation when calling __str__
+            if (obj->type == TYPE_str) { // print the bytes directly instead of a copy made by __str__
+                str_Object* str = (str_Object*) obj;
+                output_write(&vm->output, str_value(str), str->length);
+            } else if (obj->__str__) { // for primitives implemented this should never be NULL, might even cause issues if str is "" But will keep for safety
+                char repr[PRIMITIVE_FORMAT_MAX]; // formatted in place, printing a number allocates nothing
+                output_write(&vm->output, repr, format_primitive(obj, repr));
             } else {
-                printf("<unprintable primitive object>\n");
+                static const char unprintable[] = "<unprintable primitive object>";
+                output_write(&vm->output, unprintable, sizeof(unprintable) - 1);
             }
+            output_end_line(&vm->output);
         } else {
             printf("<non-primitive value cannot be printed>\n");
             return;
@@ -780,16 +1072,11 @@ void run(VM *vm, const char *bytecode_file) {
     }
 
     case OP_INPUT: {
-        char buffer[1024];
-        if (fgets(buffer, sizeof(buffer), stdin)) {
-            // Strip newline
-            size_t len = strlen(buffer);
-            if (len > 0 && buffer[len - 1] == '\n') {
-                buffer[len - 1] = '\0';
-            }
-    
-            // Always wrap as string primitive
-            push(vm, new_str(buffer), PRIMITIVE_OBJ);
+        const char* line;
+        size_t len;
+        if (input_read_line(&vm->input, &line, &len) == 1) {
+            // Always wrap as string primitive, copied straight from the read buffer
+            push(vm, new_str_len(line, len), PRIMITIVE_OBJ);
         } else {
             printf("Error: Failed to read input.\n");
             push(vm, get_constant(vm, _NULL_, 0), PRIMITIVE_OBJ);
@@ -846,8 +1133,14 @@ void run(VM *vm, const char *bytecode_file) {
             // printf("result: %d \n", result);
             push(vm, get_constant(vm, BOOL, result), PRIMITIVE_OBJ);
         // We can add inother else ifs for advanced primitive object types
+        } else if ((instruction == OP_EQ || instruction == OP_NEQ) &&
+                   (a.entry_type == ADVANCED_OBJ || b.entry_type == ADVANCED_OBJ)) {
+            // a handle is only equal to itself, never to NULL or any primitive
+            int same = a.entry_type == b.entry_type && a.value == b.value;
+            push(vm, get_constant(vm, BOOL, instruction == OP_EQ ? same : !same), PRIMITIVE_OBJ);
         } else {
             printf("Error: Comparison not implemented for non PRIMITIVE_OBJ types.\n");
+            return;
         }
         break;
     }
@@ -875,18 +1168,16 @@ void run(VM *vm, const char *bytecode_file) {
         break;
       }
 
-      char *var_name = (char *)id.value;
-      GlobalEntry *entry = (GlobalEntry *)hashmap_get(vm->globals, var_name);
+      const uint8_t *var_id = (const uint8_t *)id.value;
+      GlobalEntry *entry = (GlobalEntry *)hashmap_get_prehashed(
+          vm->globals, id_name(var_id), id_length(var_id), id_hash(var_id));
 
       if (!entry) {
-        printf("Error: Undefined global variable \"%s\".\n", var_name);
-        free(var_name);
+        printf("Error: Undefined global variable \"%.*s\".\n", id_length(var_id), id_name(var_id));
         break;
       }
 
       push(vm, entry->value, entry->entry_type);
-
-      free(var_name); // malloced during ID opcode
       break;
     }
 
@@ -910,7 +1201,7 @@ void run(VM *vm, const char *bytecode_file) {
         break;
       }
 
-      char *var_name = (char *)id.value;
+      const uint8_t *var_id = (const uint8_t *)id.value;
 
       GlobalEntry *entry = malloc(sizeof(GlobalEntry));
       entry->value = value.value;
@@ -923,40 +1214,60 @@ void run(VM *vm, const char *bytecode_file) {
       stackframes and vars so this a job for the GC) (However we can safely free
       GlobalEntry as it is simply a wrapper)
       */
-      hashmap_set(vm->globals, var_name, entry,
+      hashmap_set_prehashed(vm->globals, id_name(var_id), id_length(var_id), id_hash(var_id), entry,
                   free); // free is added here as we have to free the previous
                          // globalEntry when we reassign a variable
-
-      free(var_name); // was malloc'ed during ID opcode
       break;
     }
 
-    case OP_JMP: { //[1 byte opcode][4 byte signed offset]
-      int32_t offset;
-      memcpy(&offset, vm->bytecode_ip,
-             sizeof(int32_t)); // Read 4 bytes as a signed offset
-      vm->bytecode_ip =
-          (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                       sizeof(int32_t)); // Move past the offset bytes
+    case OP_JMP: { //[1 byte opcode][4 byte signed offset] (compact: [zigzag LEB128])
+      int64_t offset;
+      if (compact) {
+        offset = read_zigzag(&vm->bytecode_ip);
+      } else {
+        int32_t wide;
+        memcpy(&wide, vm->bytecode_ip,
+               sizeof(int32_t)); // Read 4 bytes as a signed offset
+        vm->bytecode_ip =
+            (uint64_t *)((uint8_t *)vm->bytecode_ip +
+                         sizeof(int32_t)); // Move past the offset bytes
+        offset = wide;
+      }
 
       // Apply jump
       vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip + offset);
       break;
     }
 
-    case OP_JMPIF: {
-      int32_t offset;
-      memcpy(&offset, vm->bytecode_ip, sizeof(int32_t)); // Read 4-byte offset
-      vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                                     sizeof(int32_t)); // Move past offset
+    case OP_JMP_SHORT: { // [1 byte opcode][1 byte signed offset]
+      int8_t offset = *(int8_t *)vm->bytecode_ip;
+      vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip + 1 + offset);
+      break;
+    }
+
+    case OP_JMPIF:
+    case OP_JMPIF_SHORT: { // [1 byte opcode][4 byte signed offset] (compact: [zigzag LEB128], short: [int8])
+      int64_t offset;
+      if (instruction == OP_JMPIF_SHORT) {
+        offset = *(int8_t *)vm->bytecode_ip;
+        vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip + 1);
+      } else if (compact) {
+        offset = read_zigzag(&vm->bytecode_ip);
+      } else {
+        int32_t wide;
+        memcpy(&wide, vm->bytecode_ip, sizeof(int32_t)); // Read 4-byte offset
+        vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip +
+                                       sizeof(int32_t)); // Move past offset
+        offset = wide;
+      }
 
       StackEntry condition = pop(vm);
-      if (condition.entry_type != PRIMITIVE_OBJ) {
+      if (condition.entry_type != PRIMITIVE_OBJ && condition.entry_type != ADVANCED_OBJ) {
         printf("Error: Expected PRIMITIVE_OBJ for conditional jump.\n");
         break;
       }
 
-      if (!is_truthy((PrimitiveObject *)condition.value)) {
+      if (!entry_truthy(condition)) {
         vm->bytecode_ip =
             (uint64_t *)((uint8_t *)vm->bytecode_ip + offset); // Apply jump
       }
@@ -977,7 +1288,7 @@ void run(VM *vm, const char *bytecode_file) {
         push(vm, local.value, local.entry_type);
       } else {
         printf("Error: Failed to get local variable at index %d.\n", index);
-        free(bytecode);
+        unload_bytecode(vm);
         return;
       }
       break;
@@ -988,7 +1299,7 @@ void run(VM *vm, const char *bytecode_file) {
 
       if (local_id.entry_type != IDENTIFIER) {
         printf("Error: Expected IDENTIFIER for local variable assignment.\n");
-        free(bytecode);
+        unload_bytecode(vm);
         return;
       }
       uint16_t index = (uint16_t)(uintptr_t)local_id.value;
@@ -998,13 +1309,28 @@ void run(VM *vm, const char *bytecode_file) {
       break;
     }
 
-    case LOCAL: { // [1 byte opcode][2 byte local index]
+    case LOCAL_0:
+    case LOCAL_1:
+    case LOCAL_2:
+    case LOCAL_3:
+    case LOCAL_4:
+    case LOCAL_5:
+    case LOCAL_6:
+    case LOCAL_7: // [1 byte opcode]
+      push(vm, (void *)(uintptr_t)(instruction - LOCAL_0), IDENTIFIER);
+      break;
+
+    case LOCAL: { // [1 byte opcode][2 byte local index] (compact: [LEB128 index])
       uint16_t index;
-      memcpy(&index, vm->bytecode_ip,
-             sizeof(uint16_t)); // Read 2 bytes for local index
-      vm->bytecode_ip =
-          (uint64_t *)((uint8_t *)vm->bytecode_ip +
-                       sizeof(uint16_t)); // Move past the index bytes
+      if (compact) {
+        index = (uint16_t)read_uleb(&vm->bytecode_ip);
+      } else {
+        memcpy(&index, vm->bytecode_ip,
+               sizeof(uint16_t)); // Read 2 bytes for local index
+        vm->bytecode_ip =
+            (uint64_t *)((uint8_t *)vm->bytecode_ip +
+                         sizeof(uint16_t)); // Move past the index bytes
+      }
 
       // Push the local index onto the stack (similar to how ID works)
       push(vm, (void *)(uintptr_t)index,
@@ -1021,15 +1347,12 @@ void run(VM *vm, const char *bytecode_file) {
         break;
       }
 
-      char *func_name = (char *)func_id.value;
-    //   printf("Calling func: %s\n", func_name);
-      FunctionEntry *func =
-          (FunctionEntry *)hashmap_get(vm->functions, func_name);
+      const uint8_t *func_name = (const uint8_t *)func_id.value;
+      FunctionEntry *func = find_function(vm, id_name(func_name), id_length(func_name), id_hash(func_name));
 
       if (!func) {
-        printf("Error: Undefined function '%s'.\n", func_name);
-        free(func_name);
-        free(bytecode);
+        printf("Error: Undefined function '%.*s'.\n", id_length(func_name), id_name(func_name));
+        unload_bytecode(vm);
         return;
       }
 
@@ -1040,40 +1363,203 @@ void run(VM *vm, const char *bytecode_file) {
         args[i] = pop(vm);
       }
 
-      // Save current instruction pointer for return
-      uint64_t *return_address = vm->bytecode_ip;
-
-      // Create a new stack frame
-      StackFrame *frame =
-          init_stack_frame(vm, return_address, func->local_count);
-      if (!frame) {
-        printf("Error: Failed to create stack frame for function call.\n");
-        free(func_name);
+      // Native functions run directly on the popped arguments, no stack frame is needed
+      if (func->kind == FUNC_NATIVE) {
+        StackEntry result = func->native(vm, func->num_args, args);
+        if (!result.value) {
+          printf("Error: Native function '%s' failed.\n", func->name);
+          unload_bytecode(vm);
+          return;
+        }
+        push(vm, result.value, result.entry_type);
         break;
       }
 
-      // Save current stack position as the new base pointer
-      size_t new_base_pointer = vm->stack.stack_top;
+      // Pure functions called with the same primitive arguments reuse their previous result
+      MemoKey memo_key;
+      int memoize = 0;
+      if (func->memo) {
+        memoize = memo_make_key(func->memo, args, &memo_key);
+        if (!memoize) {
+          func->memo->bypassed++;
+        } else {
+          StackEntry cached;
+          if (memo_lookup(func->memo, &memo_key, &cached)) {
+            push(vm, cached.value, cached.entry_type);
+            break;
+          }
+        }
+      }
+
+      // Return to the instruction after the call
+      enter_function(vm, func, args, vm->bytecode_ip, memoize ? &memo_key : NULL);
+      break;
+    }
 
-      // Push the frame onto the stack
-      push(vm, frame, FUNCTION_FRAME);
+    case OP_RETURN: {
+      return_from_frame(vm);
+      break;
+    }
 
-      // Update the base pointer to the new stack frame
-      vm->stack.base_pointer = new_base_pointer;
+    case OP_EXTERN: { // [1 byte] pops arg count, function ID and library path
+      StackEntry count = pop(vm);
+      StackEntry func_id = pop(vm);
+      StackEntry path = pop(vm);
+
+      if (count.entry_type != PRIMITIVE_OBJ || func_id.entry_type != IDENTIFIER ||
+          path.entry_type != PRIMITIVE_OBJ || ((PrimitiveObject *)path.value)->type != TYPE_str) {
+        printf("Error: Malformed extern declaration.\n");
+        unload_bytecode(vm);
+        return;
+      }
+
+      const uint8_t *func_name = (const uint8_t *)func_id.value;
+      int64_t num_args = ((int_Object *)count.value)->value;
+
+      if (load_native_module(vm, str_cstr((str_Object *)path.value)) != 0) {
+        unload_bytecode(vm);
+        return;
+      }
 
-      // Set the arguments as local variables in the stack frame.
-      for (int i = 0; i < func->num_args; i++) {
-        set_local(vm, i, args[i]);
+      FunctionEntry *func = (FunctionEntry *)hashmap_get_prehashed(
+          vm->functions, id_name(func_name), id_length(func_name), id_hash(func_name));
+      if (!func || func->kind != FUNC_NATIVE) {
+        printf("Error: Native module \"%s\" does not define '%.*s'.\n", str_value((str_Object *)path.value),
+               id_length(func_name), id_name(func_name));
+        unload_bytecode(vm);
+        return;
+      }
+      if (func->num_args != num_args) {
+        printf("Error: Native function '%s' takes %d arguments but was declared with %ld.\n", func->name, func->num_args, num_args);
+        unload_bytecode(vm);
+        return;
       }
 
-      // Jump to function body
-      vm->bytecode_ip = (uint64_t *)func->func_body_address;
-      free(func_name);
       break;
     }
 
-    case OP_RETURN: {
-      return_from_frame(vm);
+    case OP_INDEX: {
+      StackEntry index = pop(vm);
+      StackEntry target = pop(vm);
+      if (target.entry_type != PRIMITIVE_OBJ || ((PrimitiveObject *)target.value)->type != TYPE_str) {
+        printf("Error: Only strings can be indexed.\n");
+        unload_bytecode(vm);
+        return;
+      }
+      if (index.entry_type != PRIMITIVE_OBJ || ((PrimitiveObject *)index.value)->type != TYPE_int) {
+        printf("Error: String indices must be ints.\n");
+        unload_bytecode(vm);
+        return;
+      }
+
+      str_Object *str = (str_Object *)target.value;
+      int64_t i = ((int_Object *)index.value)->value;
+      if (i < 0) {
+        i += (int64_t)str->length;
+      }
+      if (i < 0 || (uint64_t)i >= str->length) {
+        printf("Error: String index %ld out of range for a string of length %zu.\n",
+               ((int_Object *)index.value)->value, str->length);
+        unload_bytecode(vm);
+        return;
+      }
+      push(vm, new_str_len(str_value(str) + i, 1), PRIMITIVE_OBJ); // one byte strings are shared, no allocation
+      break;
+    }
+
+    case OP_SLICE: {
+      StackEntry end = pop(vm);
+      StackEntry start = pop(vm);
+      StackEntry target = pop(vm);
+      if (target.entry_type != PRIMITIVE_OBJ || ((PrimitiveObject *)target.value)->type != TYPE_str) {
+        printf("Error: Only strings can be sliced.\n");
+        unload_bytecode(vm);
+        return;
+      }
+
+      str_Object *str = (str_Object *)target.value;
+      size_t from, to;
+      if (start.entry_type != PRIMITIVE_OBJ || end.entry_type != PRIMITIVE_OBJ ||
+          !slice_bound((PrimitiveObject *)start.value, str->length, 0, &from) ||
+          !slice_bound((PrimitiveObject *)end.value, str->length, str->length, &to)) {
+        printf("Error: Slice bounds must be ints.\n");
+        unload_bytecode(vm);
+        return;
+      }
+      if (to < from) {
+        to = from;
+      }
+      str_Object *slice = slice_str(str, from, to);
+      if (!slice) {
+        unload_bytecode(vm);
+        return;
+      }
+      push(vm, slice, PRIMITIVE_OBJ);
+      break;
+    }
+
+    case OP_FORMAT: { // [1 byte opcode][2 byte operand count] (compact: [LEB128 count])
+      uint16_t count;
+      if (compact) {
+        count = (uint16_t)read_uleb(&vm->bytecode_ip);
+      } else {
+        memcpy(&count, vm->bytecode_ip, sizeof(uint16_t));
+        vm->bytecode_ip = (uint64_t *)((uint8_t *)vm->bytecode_ip + sizeof(uint16_t));
+      }
+
+      if (vm->stack.stack_top < count) {
+        printf("Error: OP_FORMAT expects %u values on the stack.\n", count);
+        unload_bytecode(vm);
+        return;
+      }
+      StackEntry *operands = &vm->stack.stack[vm->stack.stack_top - count];
+
+      // Strings contribute their length, everything else at most PRIMITIVE_FORMAT_MAX bytes. The result is
+      // allocated once with room for that upper bound and the operands are written straight into it.
+      size_t capacity = 0;
+      for (uint16_t i = 0; i < count; i++) {
+        if (operands[i].entry_type != PRIMITIVE_OBJ) {
+          printf("Error: Only primitive values can be formatted into a string.\n");
+          unload_bytecode(vm);
+          return;
+        }
+        PrimitiveObject *obj = (PrimitiveObject *)operands[i].value;
+        capacity += obj->type == TYPE_str ? ((str_Object *)obj)->length : PRIMITIVE_FORMAT_MAX;
+      }
+
+      str_Object *result = alloc_str(capacity);
+      if (!result) {
+        printf("Error: Failed to allocate formatted string of %zu bytes.\n", capacity);
+        unload_bytecode(vm);
+        return;
+      }
+      size_t length = 0;
+      for (uint16_t i = 0; i < count; i++) {
+        PrimitiveObject *obj = (PrimitiveObject *)operands[i].value;
+        if (obj->type == TYPE_str) {
+          str_Object *str = (str_Object *)obj;
+          memcpy(result->value + length, str_value(str), str->length);
+          length += str->length;
+        } else {
+          length += format_primitive(obj, result->value + length);
+        }
+      }
+      result->value[length] = '\0';
+      result->length = length;
+      vm->stack.stack_top -= count;
+
+      if (length <= 1) { // keep "" and one byte strings shared
+        str_Object *small = new_str_len(result->value, length);
+        free(result);
+        result = small;
+      } else if (capacity - length >= PRIMITIVE_FORMAT_MAX) { // give back the unused room of a long estimate
+        str_Object *shrunk = realloc(result, sizeof(str_Object) + length + 1);
+        if (shrunk) {
+          shrunk->value = shrunk->data;
+          result = shrunk;
+        }
+      }
+      push(vm, result, PRIMITIVE_OBJ);
       break;
     }
 
@@ -1084,7 +1570,7 @@ void run(VM *vm, const char *bytecode_file) {
     }
   }
 
-  free(bytecode); // Clean up allocated memory
+  unload_bytecode(vm);
 }
 
 /* ///////////////////////// VM FUNCTIONS ///////////////////////// */
@@ -7,15 +7,25 @@
 #include "../CorePrimitives/core_primitives.h"
 #include "../AdvancedPrimitives/advanced_primitives.h"
 #include "../hashmap/hashmap.h"
+#include "output.h"
+#include "input.h"
 
 #define STACK_MAX 4096
 #define MAX_CONSTANTS 1024
 #define MAX_GLOBALS 1024
 #define MAX_FUNCTIONS 1024
 #define MAX_OBJECTS 1024
+#define MAX_NATIVE_MODULES 64
+#define SMALL_INT_MAX 510 // ints from -SMALL_INT_MAX to SMALL_INT_MAX are preloaded in the constant table
+
+/* Function header flags (FUNCFLAGS) */
+#define FUNC_FLAG_PURE 0x1 // set by the semantic checker, results of the function may be memoized
+#define FUNC_FLAG_RESOLVED 0x8000 // vm only: native function known not to be shadowed by a function of the script
 
 /* Forward declaration */
 typedef struct PrimitiveObject PrimitiveObject;
+typedef struct MemoCache MemoCache;
+typedef struct VM VM;
 
 /* Bytecode Instructions */
 typedef enum {
@@ -34,11 +44,11 @@ typedef enum {
 
     // OPCODE primitives (SYNTAX: TYPE (ARG))
     INT,           // prim obj int representation [1 byte][8 bytes]
-    FLOAT,         // prim obj float representation [1 byte][8 bytes]
+    FLOAT,         // prim obj float representation [1 byte][8 bytes] (IR and constant pool only, code uses OP_CONST)
     BOOL,          // prim obj bool representation [1 byte][1 byte]
-    STR,           // prim obj str representation [1 byte][]
+    STR,           // prim obj str representation [1 byte][4 byte length][bytes] (IR and constant pool only, code uses OP_CONST)
     _NULL_,        // prim _NULL_ representation [1 byte]
-    ID,            // ID representation [1 byte opcode][2 byte ID length][ ID length number of bytes]
+    ID,            // ID representation [1 byte opcode][2 byte ID length][8 byte hash][ ID length number of bytes]
 
     // OPCODE flags (SYNTAX: FLAG (NO ARG))
     OP_FUNCDEF,    // Flag for start of function definition [1 byte]
@@ -80,7 +90,28 @@ typedef enum {
     OP_PARSEINT,
     OP_PARSESTR,
     OP_PARSEFLOAT,
-    OP_PARSEBOOL
+    OP_PARSEBOOL,
+
+    OP_EXTERN,     // Pops arg count, function ID and library path, loads the native library [1 byte]
+
+    OP_INDEX,      // Pops an int index and a str, pushes the one byte str at that index [1 byte]
+    OP_SLICE,      // Pops end, start (int or NULL) and a str, pushes the slice as a view of the str [1 byte]
+    OP_FORMAT,     // Pops n values and pushes their concatenated text (f-strings) [1 byte opcode][2 byte n]
+
+    // OPCODE short forms, only in the compact encoding (BYTECODE_FLAG_COMPACT)
+    INT8,          // INT between -128 and 127 [1 byte opcode][1 byte int8]
+    OP_JMP_SHORT,  // OP_JMP with a small offset [1 byte opcode][1 byte signed offset]
+    OP_JMPIF_SHORT,// OP_JMPIF with a small offset [1 byte opcode][1 byte signed offset]
+    LOCAL_0,       // LOCAL 0 to LOCAL 7 with the index in the opcode [1 byte]
+    LOCAL_1,
+    LOCAL_2,
+    LOCAL_3,
+    LOCAL_4,
+    LOCAL_5,
+    LOCAL_6,
+    LOCAL_7,
+
+    OP_CONST       // Pushes entry n of the constant pool [1 byte opcode][4 byte n] (compact: [LEB128 n])
 } OpCode;
 
 
@@ -104,6 +135,34 @@ typedef struct Stack{
     StackEntry stack[STACK_MAX];
 } Stack;
 
+/*
+IDENTIFIER entries pushed by ID point at the operand inside the loaded bytecode ([2 byte length][8 byte hash][name]),
+nothing is copied or allocated. The name is not NUL terminated and the hash is hashmap_hash(name, length).
+IDENTIFIER entries pushed by LOCAL hold the local index instead.
+*/
+static inline uint16_t id_length(const uint8_t *id) {
+    uint16_t length;
+    memcpy(&length, id, sizeof(uint16_t));
+    return length;
+}
+
+static inline uint64_t id_hash(const uint8_t *id) {
+    uint64_t h;
+    memcpy(&h, id + sizeof(uint16_t), sizeof(uint64_t));
+    return h;
+}
+
+static inline const char *id_name(const uint8_t *id) {
+    return (const char *)id + sizeof(uint16_t) + sizeof(uint64_t);
+}
+
+// Order of the function directory: names compare bytewise, a name sorts before the longer names it is a prefix of
+static inline int id_compare(const uint8_t *id, const char *name, size_t length) {
+    size_t own_length = id_length(id);
+    int order = memcmp(id_name(id), name, own_length < length ? own_length : length);
+    return order ? order : (own_length > length) - (own_length < length);
+}
+
 /* /////////////////////////////// STACK TABLE /////////////////////////////// */
 
 /* /////////////////////////////// GLOBAL TABLE /////////////////////////////// */
@@ -117,15 +176,53 @@ typedef struct GlobalEntry{
 
 /* /////////////////////////////// FUNCTION TABLE /////////////////////////////// */
 
+typedef enum {
+    FUNC_BYTECODE, // body is bytecode at func_body_address
+    FUNC_NATIVE,   // body is a C function (see native.h)
+} FunctionKind;
+
+/* Native function: receives the call arguments in order and returns the value to push.
+   Returning an entry with a NULL value signals an error and stops the vm. */
+typedef StackEntry (*NativeFn)(VM *vm, int argc, StackEntry *args);
+
 typedef struct {
     char *name;       // Function name
+    FunctionKind kind;
+    NativeFn native;  // Only for FUNC_NATIVE
     size_t func_body_address; // Location of first instruction in body
     int num_args;      //Need to know number of arguments to pop out during OP_CALL
     int local_count;    //Number of local variables (including arguments)
+    uint16_t flags;     // FUNCFLAGS from the function header
+    MemoCache *memo;    // Result cache for pure functions (NULL if the function is not memoized)
 } FunctionEntry;
 
 /* /////////////////////////////// FUNCTION TABLE /////////////////////////////// */
 
+/* /////////////////////////////// RECORD MODE /////////////////////////////// */
+/*
+ratsnake -n: the top level code runs once, then begin() (if defined), on_line(line) for every line of stdin and
+end() (if defined) are called on the same vm, so globals carry over from one record to the next.
+*/
+
+#define RECORD_BEGIN_FN "begin"
+#define RECORD_LINE_FN "on_line"
+#define RECORD_END_FN "end"
+
+typedef enum {
+    RECORD_BEGIN,
+    RECORD_LINES,
+    RECORD_END,
+    RECORD_DONE,
+} RecordStage;
+
+typedef struct {
+    int enabled;
+    RecordStage stage; // next hook to call once the current one returns
+    FunctionEntry *on_line;
+} RecordMode;
+
+/* /////////////////////////////// RECORD MODE /////////////////////////////// */
+
 /* /////////////////////////////// OBJECT TABLE /////////////////////////////// */
 
 typedef struct {
@@ -138,13 +235,49 @@ typedef struct {
 /* /////////////////////////////// HEADER /////////////////////////////// */
 
 typedef struct {
-  size_t func_section_start; // Start location of function section
-  size_t func_section_end;   // End location of function section
-  size_t class_section_start; // Start location of class section
-  size_t class_section_end;   // End location of class section
-  size_t execution_section_start;   // Start location of bytecode that is executed
-  uint8_t padding[24];         // 24 bytes of padding
-} BytecodeHeader;
+  uint32_t func_section_start; // Start location of function section
+  uint32_t func_section_end;   // End location of function section
+  uint32_t class_section_start; // Start location of class section
+  uint32_t class_section_end;   // End location of class section
+  uint32_t execution_section_start;   // Start location of bytecode that is executed
+  uint32_t function_count;     // Number of FunctionDirEntry in the directory
+  uint32_t directory_start;    // Start of the function directory (8 byte aligned, after the code)
+  uint32_t pool_start;         // Start of the constant pool (after the directory)
+  uint32_t pool_count;         // Number of constants, each one an INT, FLOAT or STR instruction in the standard encoding
+  uint32_t reserved;           // 0
+  uint64_t hash_check;         // hashmap_hash(HASH_CHECK_KEY) of the compiling process, ID hashes are only valid for that seed
+  uint32_t version;            // BYTECODE_VERSION of the compiler that wrote the file (at offset 48 in every version)
+  uint32_t flags;              // BYTECODE_FLAG_* bits
+  uint64_t checksum;           // bytecode_checksum of everything after the header
+} BytecodeHeader; // 64 bytes, offsets are 32 bit like the ones of the function directory
+
+/*
+One entry per function of the func section, sorted by name (id_compare) with one entry per name, so the vm binds a
+function with a binary search the first time it is called instead of walking every definition at startup.
+*/
+typedef struct {
+  uint32_t name_offset; // ID operand of the name ([2 byte length][8 byte hash][name])
+  uint32_t body_offset; // First instruction of the body
+  uint32_t body_length; // Bytes of the body, the last one is OP_ENDFUNC
+  uint16_t num_args;    // NUMARGS
+  uint16_t num_vars;    // NUMVARS
+  uint16_t flags;       // FUNCFLAGS
+  uint16_t reserved;
+} FunctionDirEntry;
+
+#define HASH_CHECK_KEY "ratsnake"
+#define BYTECODE_VERSION 4 // bump whenever the layout of .rtskbin files changes
+
+/*
+Compact encoding (compile_ir -compact): the operands of INT, OP_CONST, LOCAL, OP_FORMAT, OP_JMP and OP_JMPIF are
+unsigned LEB128, signed ones zigzag encoded first (0, -1, 1, -2, ... become 0, 1, 2, 3, ...), and the short forms
+INT8, OP_JMP_SHORT, OP_JMPIF_SHORT and LOCAL_0 to LOCAL_7 are used where they fit. ID, BOOL, the function headers
+and the constant pool are the same in both encodings.
+*/
+#define BYTECODE_FLAG_COMPACT 0x1
+
+// Checksum stored in the header (not cryptographic, it catches truncated and corrupted files)
+uint64_t bytecode_checksum(const uint8_t *bytes, size_t length);
 
 /* /////////////////////////////// HEADER /////////////////////////////// */
 
@@ -160,11 +293,37 @@ typedef struct VM {
 
     Hashmap * functions;  // Function storage
 
+    Hashmap * strings;  // Intern table: bytes -> unique str_Object (string literals)
+
+
     // implement an instance table for garbage collection
 
     PrimitiveObject * constants[MAX_CONSTANTS]; // Constant table (stores integer and float constants for quick lookup) We technically do not need to free this as it should never grow beyond the table size
     int constantCount;
 
+    MemoCache * memo_caches[MAX_FUNCTIONS]; // Result caches of every memoized function (for -memo-stats)
+    int memoCount;
+    int memo_stats; // print memo hit rates when the vm halts
+
+    void * native_modules[MAX_NATIVE_MODULES]; // handles of libraries loaded by OP_EXTERN
+    char * native_module_paths[MAX_NATIVE_MODULES];
+    int nativeModuleCount;
+
+    OutputBuffer output; // stdout buffer of OP_PRINT (-obuf=SIZE)
+    InputReader input;   // stdin reader of OP_INPUT
+    struct FileHandle * open_files; // files opened by open() and not closed yet (builtins.h)
+    struct EventLoop * events;      // created by the first async builtin (event_loop.h)
+
+    RecordMode records; // -n
+
+    const uint8_t * image;  // the loaded .rtskbin, mapped read-only (or read into memory if it can not be mapped)
+    size_t image_size;
+    int image_mapped;
+    const FunctionDirEntry * directory; // function directory inside the image, functions are bound on first call
+    size_t function_count;
+    PrimitiveObject ** pool; // constant pool of the image, materialized at load and pushed by OP_CONST (never freed)
+    size_t pool_count;
+
     uint64_t* bytecode_ip;  // Pointer to bytecode (bytecode should reasonably not exceed 2^64)
 } VM;
 